@@ -0,0 +1,35 @@
+#include "BowFriction.h"
+
+BowFriction::BowFriction(float a)
+{
+    setCharacteristic(a);
+}
+
+void BowFriction::reset()
+{
+    vr = 0;
+    hasSolution = false;
+    thermal.temperature = 0;
+}
+
+void BowFriction::setCharacteristic(float value)
+{
+    if (value == a)
+    {
+        return;
+    }
+
+    a = value;
+    exponential.setCharacteristic(a);
+    tabulated.setCharacteristic(a);
+    thermal.curve.setCharacteristic(a);
+}
+
+void BowFriction::setModel(FrictionModel value)
+{
+    if (value != model)
+    {
+        model = value;
+        reset();
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "FrictionModels.h"
+
+/// The friction between a bow and a string, solving for the relative bow
+/// velocity with the selected friction model.
+///
+/// Each solve is warm started from the solution of the previous sample. The
+/// model is chosen once per solve, after which the solver instantiated for
+/// that model runs without any virtual calls.
+class BowFriction
+{
+    public:
+    /// Create a new bow friction using the tabulated exponential curve.
+    /// @param  a   The friction characteristic.
+    BowFriction(float a = 100);
+
+    /// Get the average number of Newton-Raphson iterations per solve since the
+    /// telemetry was last reset.
+    float getAverageIterations() const { return telemetry.getAverageIterations(); };
+
+    /// Get the friction characteristic.
+    float getCharacteristic() const { return a; };
+
+    /// Get the exponential friction model.
+    ExponentialFriction &getExponential() { return exponential; };
+
+    /// Get the hyperbolic friction model.
+    HyperbolicFriction &getHyperbolic() { return hyperbolic; };
+
+    /// Get the number of Newton-Raphson iterations used by the last solve.
+    int getLastIterations() const { return telemetry.lastIterations; };
+
+    /// Get the largest absolute error of the tabulated curve, measured when
+    /// the table was built.
+    float getMaxError() const { return tabulated.getMaxError(); };
+
+    /// Get the selected friction model.
+    FrictionModel getModel() const { return model; };
+
+    /// Get the largest number of Newton-Raphson iterations used by a single
+    /// solve since the telemetry was last reset.
+    int getPeakIterations() const { return telemetry.peakIterations; };
+
+    /// Get the tabulated friction model.
+    TabulatedFriction &getTabulated() { return tabulated; };
+
+    /// Get the thermal friction model.
+    ThermalFriction &getThermal() { return thermal; };
+
+    /// Get the number of solves that hit the iteration limit since the
+    /// telemetry was last reset.
+    int getUnconvergedSolves() const { return telemetry.unconvergedSolves; };
+
+    /// Forget the previous solution, such that the next solve starts over.
+    void reset();
+
+    /// Reset the iteration counters.
+    void resetTelemetry() { telemetry = FrictionTelemetry(); };
+
+    /// Set the friction characteristic of the models based on the exponential
+    /// curve.
+    /// @param  value   The desired friction characteristic.
+    void setCharacteristic(float value);
+
+    /// Set the largest number of Newton-Raphson iterations of a solve.
+    /// @param  value   The desired number of iterations.
+    void setMaxIterations(int value) { maxIterations = value; };
+
+    /// Select the friction model.
+    /// @param  value   The desired friction model.
+    void setModel(FrictionModel value);
+
+    /// Set the sample rate, used by models with internal state.
+    /// @param  value   The sample rate.
+    void setSampleRate(float value) { thermal.k = 1 / value; };
+
+    /// Solve vr = c0 - c1 phi(vr) for the relative velocity vr.
+    /// @param  c0      The relative velocity in the absence of friction.
+    /// @param  c1      How strongly friction affects the relative velocity.
+    /// @param  guess   The initial guess, used if there is no previous solution.
+    /// @returns        The value of the friction curve at the solution.
+    inline float solve(float c0, float c1, float guess);
+
+    private:
+    FrictionModel model = FrictionModel::Tabulated;
+    ExponentialFriction exponential;
+    TabulatedFriction tabulated;
+    HyperbolicFriction hyperbolic;
+    ThermalFriction thermal;
+    float a = 0;
+
+    // Newton-Raphson state.
+    float vr = 0;
+    bool hasSolution = false;
+    int maxIterations = 20;
+    float tolerance = 1e-3;
+
+    FrictionTelemetry telemetry;
+};
+
+inline float BowFriction::solve(float c0, float c1, float guess)
+{
+    if (!hasSolution)
+    {
+        vr = guess;
+        hasSolution = true;
+    }
+
+    switch (model)
+    {
+        case FrictionModel::Exponential:
+            return solveFriction(exponential, vr, c0, c1, maxIterations, tolerance, telemetry);
+        case FrictionModel::Hyperbolic:
+            return solveFriction(hyperbolic, vr, c0, c1, maxIterations, tolerance, telemetry);
+        case FrictionModel::Thermal:
+            return solveFriction(thermal, vr, c0, c1, maxIterations, tolerance, telemetry);
+        default:
+            return solveFriction(tabulated, vr, c0, c1, maxIterations, tolerance, telemetry);
+    }
+}
@@ -0,0 +1,144 @@
+#include "Bridge.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef PAL
+#include "pal/Gui.h"
+#endif
+
+Bridge::Bridge(const BridgeParameters &params, float sampleRate) :
+    k(1 / sampleRate),
+    frame(2)
+{
+    setParameters(params);
+}
+
+int Bridge::addString(StringModel *string, float position)
+{
+    Connection connection;
+    connection.string = string;
+    connection.point.setPosition(position, string->getSize(), Interpolation::Linear);
+    connections.push_back(connection);
+    predictions.resize(connections.size());
+    forces.resize(connections.size());
+    update();
+    return connections.size() - 1;
+}
+
+void Bridge::draw()
+{
+#ifdef PAL
+    BridgeParameters value = params;
+    bool changed = false;
+
+    changed |= ImGui::SliderFloat("Bridge mass", &value.mass, 0.1, 100, "%.1f", 2);
+    changed |= ImGui::SliderFloat("Bridge frequency", &value.frequency, 50, 2000);
+    changed |= ImGui::SliderFloat("Bridge decay", &value.decay, 0, 200);
+    changed |= ImGui::SliderFloat("Connection stiffness", &value.connection, 1e3, 1e7, "%.0f", 4);
+
+    if (changed)
+        setParameters(value);
+
+    ImGui::Text("Bridge displacement: %g", w);
+#endif
+}
+
+void Bridge::process(float *out, int numFrames, int numChannels)
+{
+    if (frame.size() < numChannels)
+        frame.resize(numChannels);
+
+    for (int i = 0; i < numFrames; i++)
+        step(out + i * numChannels, numChannels);
+}
+
+void Bridge::reset()
+{
+    w = 0;
+    wp = 0;
+
+    for (auto &connection : connections)
+    {
+        connection.u = 0;
+        connection.up = 0;
+    }
+}
+
+void Bridge::setParameters(const BridgeParameters &value)
+{
+    params = value;
+
+    // M w'' = -M omega^2 w - 2 M sigma w' + F, with centered differences.
+    float omega = 2 * M_PI * params.frequency;
+    float c = 1 / (1 + params.decay * k);
+
+    a = c * (2 - omega * omega * k * k);
+    b = c * (1 - params.decay * k);
+    m = c * k * k / params.mass;
+
+    update();
+}
+
+void Bridge::step(float *out, int numChannels)
+{
+    float half = 0.5f * params.connection;
+    float wt = a * w - b * wp;
+    float s = 0;
+
+    for (int i = 0; i < numChannels; i++)
+        out[i] = 0;
+
+    // The connection forces F = K/2 ((un + up) - (wn + wp)), where un and wn
+    // depend on F. Predict un and wn without the connections first.
+    for (int i = 0; i < connections.size(); i++)
+    {
+        Connection &connection = connections[i];
+        connection.string->computeForces();
+
+        predictions[i] = connection.string->predict(connection.point);
+        forces[i] = half * (predictions[i] + connection.up - wt - wp);
+        s += connection.inverse * forces[i];
+    }
+
+    float total = 0;
+
+    for (int i = 0; i < connections.size(); i++)
+    {
+        Connection &connection = connections[i];
+        const ExcitationPoint &point = connection.point;
+        float force = connection.inverse * (forces[i] - beta * s);
+
+        for (int j = 0; j < point.taps; j++)
+            connection.string->applyForce(point.index + j, -point.weights[j] * force);
+
+        connection.up = connection.u;
+        connection.u = predictions[i] - connection.gain * force;
+        total += force;
+
+        connection.string->getNext(frame.data(), numChannels);
+
+        for (int c = 0; c < numChannels; c++)
+            out[c] += frame[c];
+    }
+
+    wp = w;
+    w = wt + m * total;
+}
+
+void Bridge::update()
+{
+    // The system (D + alpha 1 1^T) F = r, with D = I + K/2 diag(gain) and
+    // alpha = K/2 m, has the inverse D^-1 - beta D^-1 1 1^T D^-1.
+    float half = 0.5f * params.connection;
+    float alpha = half * m;
+    float sum = 0;
+
+    for (auto &connection : connections)
+    {
+        connection.gain = connection.string->getForceGain(connection.point);
+        connection.inverse = 1 / (1 + half * connection.gain);
+        sum += connection.inverse;
+    }
+
+    beta = alpha / (1 + alpha * sum);
+}
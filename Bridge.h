@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Excitation.h"
+#include "StringModel.h"
+#include <vector>
+
+/// The physical parameters of a bridge.
+struct BridgeParameters
+{
+    float mass = 1;             // The mass, relative to that of a string.
+    float frequency = 300;      // The resonance frequency of the bridge.
+    float decay = 30;           // The decay rate of the bridge resonance.
+    float connection = 1e5;     // The stiffness of each string's connection.
+};
+
+/// Several strings attached to a shared bridge, a damped mass-spring system.
+/// Each string is connected to the bridge by a stiff spring at a point near
+/// its end, and the strings exchange energy through the motion of the bridge.
+///
+/// The connection forces are solved every time step from the state the
+/// strings and bridge will be in after it, which keeps the coupling stable
+/// however stiff the connections. That gives a linear system with one row
+/// per string, whose matrix only depends on the parameters: a diagonal plus a
+/// rank one term from the shared bridge. Its inverse is precomputed in the
+/// Sherman-Morrison form, which solves it in O(strings) per time step.
+class Bridge
+{
+    public:
+    /// Create a bridge without strings.
+    /// @param  params      The parameters of the bridge.
+    /// @param  sampleRate  The sample rate to use (default 44100).
+    Bridge(const BridgeParameters &params = BridgeParameters(), float sampleRate = 44100);
+
+    /// Attach a string to the bridge. The string must outlive the bridge, and
+    /// is run by the bridge from then on.
+    /// @param  string      The string.
+    /// @param  position    Where the string is connected, as a fraction of its
+    ///                     length.
+    /// @returns            The index of the string.
+    int addString(StringModel *string, float position = 0);
+
+    /// Draw a UI for controlling the bridge.
+    void draw();
+
+    /// Get the displacement of the bridge.
+    float getDisplacement() const { return w; };
+
+    /// Get the parameters of the bridge.
+    const BridgeParameters &getParameters() const { return params; };
+
+    /// Compute a block of the output of all strings, with the pickups of each
+    /// string mixed into the same frames.
+    /// @param  out             Where to write the interleaved output.
+    /// @param  numFrames       The number of frames to compute.
+    /// @param  numChannels     The number of channels per frame.
+    void process(float *out, int numFrames, int numChannels);
+
+    /// Bring the bridge and all connections to rest. The strings are not
+    /// reset.
+    void reset();
+
+    /// Set the parameters of the bridge.
+    /// @param  value   The parameters.
+    void setParameters(const BridgeParameters &value);
+
+    /// Precompute the inverse of the coupling system, which must be done
+    /// whenever the parameters of an attached string change.
+    void update();
+
+    private:
+    struct Connection
+    {
+        StringModel *string = nullptr;
+        ExcitationPoint point;
+        float up = 0;       // The previous displacement of the string at the
+                            // connection.
+        float u = 0;        // The current displacement.
+        float gain = 0;     // How far a unit force moves the connection.
+        float inverse = 0;  // The inverse of the diagonal part.
+    };
+
+    /// Advance the strings and bridge one time step, mixing the pickups of
+    /// all strings into one frame.
+    /// @param  out             Where to write the frame.
+    /// @param  numChannels     The number of channels in the frame.
+    void step(float *out, int numChannels);
+
+    BridgeParameters params;
+    float k = 0;
+    std::vector<Connection> connections;
+    std::vector<float> frame;   // The frame of a single string.
+    std::vector<float> predictions; // The connections without their forces.
+    std::vector<float> forces;      // The connection forces.
+
+    // The bridge, wn = a w - b wp + m F.
+    float a = 0;
+    float b = 0;
+    float m = 0;
+    float w = 0;
+    float wp = 0;
+
+    float beta = 0;     // The scale of the rank one part of the inverse.
+};
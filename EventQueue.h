@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+/// A queue passing events from one thread to another, such as from the GUI to
+/// the audio thread, without locks. All events are made up front, so neither
+/// thread allocates, and the consumer reads each event in place, such that
+/// an event holding on to shared data, like tables or profiles, is only ever
+/// released by the producer writing over it.
+template <typename Event>
+class EventQueue
+{
+    public:
+    /// Create a queue.
+    /// @param  capacity    The most events the queue holds at once.
+    EventQueue(int capacity) :
+        events(capacity + 1),
+        head(0),
+        tail(0)
+    {
+    }
+
+    /// Get the oldest event, on the consumer thread.
+    /// @returns    The event, which stays valid until `pop`, or null if the
+    ///             queue is empty.
+    const Event *front() const
+    {
+        int h = head.load(std::memory_order_relaxed);
+        return h == tail.load(std::memory_order_acquire) ? nullptr : &events[h];
+    };
+
+    /// Remove the oldest event, on the consumer thread.
+    void pop()
+    {
+        int h = head.load(std::memory_order_relaxed);
+        head.store((h + 1) % events.size(), std::memory_order_release);
+    };
+
+    /// Queue an event, on the producer thread.
+    /// @param  event   The event.
+    /// @returns        False if the queue is full and the event was dropped.
+    bool push(const Event &event)
+    {
+        int t = tail.load(std::memory_order_relaxed);
+        int next = (t + 1) % events.size();
+
+        if (next == head.load(std::memory_order_acquire))
+            return false;
+
+        events[t] = event;
+        tail.store(next, std::memory_order_release);
+        return true;
+    };
+
+    private:
+    std::vector<Event> events;
+    std::atomic<int> head;  // The oldest event, only written by the consumer.
+    std::atomic<int> tail;  // The next free slot, only written by the producer.
+};
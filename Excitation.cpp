@@ -0,0 +1,608 @@
+#include "Excitation.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#ifdef PAL
+#include "pal/Gui.h"
+#endif
+
+void ExcitationPoint::setPosition(float value, int n, Interpolation type)
+{
+    this->position = value;
+    this->n = n;
+    this->type = type;
+
+    // Keep all touched points at least two points from the boundaries, where
+    // the interior stencil applies.
+    float x = value * n;
+
+    if (type == Interpolation::Cubic)
+    {
+        x = std::min<float>(std::max<float>(x, 3), n - 5);
+        int i = floor(x);
+        float t = x - i;
+
+        index = i - 1;
+        taps = 4;
+        weights[0] = -t * (t - 1) * (t - 2) / 6;
+        weights[1] = (t + 1) * (t - 1) * (t - 2) / 2;
+        weights[2] = -(t + 1) * t * (t - 2) / 2;
+        weights[3] = (t + 1) * t * (t - 1) / 6;
+    }
+    else
+    {
+        x = std::min<float>(std::max<float>(x, 2), n - 4);
+        int i = floor(x);
+        float t = x - i;
+
+        index = i;
+        taps = 2;
+        weights[0] = 1 - t;
+        weights[1] = t;
+        weights[2] = 0;
+        weights[3] = 0;
+    }
+
+    norm = 0;
+
+    for (int j = 0; j < taps; j++)
+        norm += weights[j] * weights[j];
+}
+
+FretTable::FretTable(const StringParameters &params, float k, int n) :
+    params(params),
+    k(k),
+    n(n)
+{
+}
+
+void FretTable::fill() const
+{
+    std::call_once(filled, &FretTable::tabulate, this);
+}
+
+float FretTable::frequency(double lambda) const
+{
+    // The scheme turns an eigenvalue into (2 / k)^2 sin^2(omega k / 2).
+    return 2 / k * asin(std::min(0.5 * k * sqrt(lambda), 1.0)) / (2 * M_PI);
+}
+
+float FretTable::getFrequency(float position) const
+{
+    fill();
+    float t = (position - minPosition) / (1 - minPosition) * (size - 1);
+    t = std::min<float>(std::max<float>(t, 0), size - 1);
+    int j = std::min<int>(t, size - 2);
+    return frequencies[j] + (t - j) * (frequencies[j+1] - frequencies[j]);
+}
+
+float FretTable::getOpenFrequency() const
+{
+    fill();
+    return frequency(modes[0]);
+}
+
+float FretTable::getPosition(float frequency) const
+{
+    if (frequency <= getOpenFrequency())
+        return 1;
+
+    // The frequency falls as the finger moves away, so search the reversed
+    // order.
+    auto it = std::lower_bound(frequencies.begin(), frequencies.end(), frequency, std::greater<float>());
+    int j = std::min<int>(std::max<int>(it - frequencies.begin(), 1), size - 1);
+    float a = frequencies[j-1];
+    float b = frequencies[j];
+    float t = a > b ? std::min(std::max((a - frequency) / (a - b), 0.0f), 1.0f) : 0;
+    return minPosition + (1 - minPosition) * (j - 1 + t) / (size - 1);
+}
+
+bool FretTable::matches(const StringParameters &params, float k, int n) const
+{
+    return k == this->k && n == this->n && params.gamma0 == this->params.gamma0
+        && params.kappa0 == this->params.kappa0;
+}
+
+double FretTable::solve(int m, double guess) const
+{
+    // The response at the finger, sum coupling / (mode - lambda), rises from
+    // minus to plus infinity between the two modes. Solve for its root by
+    // Newton-Raphson, bisecting whenever a step leaves the bracket.
+    double lo = modes[m];
+    double hi = modes[m+1];
+    double lambda = guess > lo && guess < hi ? guess : 0.5 * (lo + hi);
+
+    for (int i = 0; i < 50; i++)
+    {
+        double g = 0;
+        double slope = 0;
+
+        for (int q = 0; q < n; q++)
+        {
+            double r = 1 / (modes[q] - lambda);
+            g += coupling[q] * r;
+            slope += coupling[q] * r * r;
+        }
+
+        if (g > 0)
+            hi = lambda;
+        else
+            lo = lambda;
+
+        double next = lambda - g / slope;
+
+        if (!(next > lo && next < hi))
+            next = 0.5 * (lo + hi);
+
+        if (fabs(next - lambda) <= 1e-12 * lambda)
+            return next;
+
+        lambda = next;
+    }
+
+    return lambda;
+}
+
+void FretTable::tabulate() const
+{
+    // The modes of the whole string are sines, with the eigenvalues of the
+    // second difference D = (2 / h)^2 sin^2(m pi / 2 (n + 1)) and of the
+    // scheme gamma0 D + kappa0 D^2.
+    double h = 1.0 / n;
+    modes.resize(n);
+    coupling.resize(n);
+    frequencies.resize(size);
+
+    for (int m = 0; m < n; m++)
+    {
+        double d = pow(2 / h * sin(0.5 * M_PI * (m + 1) / (n + 1)), 2);
+        modes[m] = params.gamma0 * d + params.kappa0 * d * d;
+    }
+
+    for (int j = 0; j < size; j++)
+    {
+        ExcitationPoint point;
+        point.setPosition(minPosition + (1 - minPosition) * j / (size - 1.0), n, Interpolation::Linear);
+
+        for (int m = 0; m < n; m++)
+        {
+            double y = 0;
+
+            for (int t = 0; t < point.taps; t++)
+                y += point.weights[t] * sin(M_PI * (m + 1) * (point.index + t + 1) / (n + 1));
+
+            coupling[m] = y * y;
+        }
+
+        // Start from the fundamental of a string as long as the stopped
+        // part, and take the closest eigenvalue of the pinned string, which
+        // lies between two neighbouring ones of the whole string.
+        double length = (point.index + point.weights[1] + 1) * h;
+        double d = pow(2 / h * sin(0.5 * M_PI * h / length), 2);
+        double guess = params.gamma0 * d + params.kappa0 * d * d;
+        int m = std::upper_bound(modes.begin(), modes.end(), guess) - modes.begin() - 1;
+        double best = guess;
+        double distance = INFINITY;
+
+        for (int i = std::max(m - 1, 0); i <= std::min(m + 1, n - 2); i++)
+        {
+            double lambda = solve(i, guess);
+
+            if (fabs(lambda - guess) < distance)
+            {
+                best = lambda;
+                distance = fabs(lambda - guess);
+            }
+        }
+
+        frequencies[j] = frequency(best);
+    }
+}
+
+void Hammer::felt(double r, double rp, double &force, double &slope) const
+{
+    // The felt stores the energy K / (p + 1) compression^(p + 1), and the
+    // force is its difference quotient between the two compressions.
+    double K = stiffness;
+    double p = exponent;
+    double a = std::max(r, 0.0);
+    double b = std::max(rp, 0.0);
+    double d = r - rp;
+
+    if (fabs(d) > 1e-6 * std::max(a, b) && fabs(d) > 1e-30)
+    {
+        force = K / (p + 1) * (pow(a, p + 1) - pow(b, p + 1)) / d;
+        slope = (K * pow(a, p) - force) / d;
+    }
+    else
+    {
+        // The quotient tends to the derivative at the midpoint.
+        double m = std::max(0.5 * (r + rp), 0.0);
+        force = K * pow(m, p);
+        slope = 0.5 * K * p * pow(m, p - 1);
+    }
+}
+
+double Hammer::solve(double a, double b, double rp)
+{
+    // The residual G(r) = r - a + b F(r) increases with r. As F is never
+    // negative, the root lies between a - b F(a) and a.
+    double force = 0;
+    double slope = 0;
+    felt(a, rp, force, slope);
+
+    if (force <= 0)
+    {
+        telemetry.record(0, true);
+        r = a;
+        return 0;
+    }
+
+    double lo = a - b * force;
+    double hi = a;
+    double tolerance = 1e-6 * (hi - lo);
+
+    // Start from the compression extrapolated from the last two.
+    double guess = std::min(std::max(2 * r - rp, lo), hi);
+    int i = 0;
+    bool converged = false;
+
+    for (; i < maxIterations && !converged; i++)
+    {
+        felt(guess, rp, force, slope);
+        double residual = guess - a + b * force;
+
+        if (residual > 0)
+            hi = guess;
+        else
+            lo = guess;
+
+        // Take the Newton-Raphson step, or bisect if it leaves the bracket.
+        double next = guess - residual / (1 + b * slope);
+
+        if (!(next > lo && next < hi))
+            next = 0.5 * (lo + hi);
+
+        converged = fabs(next - guess) <= tolerance || hi - lo <= tolerance;
+        guess = next;
+    }
+
+    telemetry.record(i, converged);
+    felt(guess, rp, force, slope);
+    r = guess;
+    return force;
+}
+
+void Hammer::start(float value)
+{
+    velocity = value;
+    time = 0;
+    active = true;
+    started = false;
+}
+
+// Free the entries of a cache only the cache holds on to.
+template <typename Map>
+static void evict(Map &map)
+{
+    for (auto it = map.begin(); it != map.end();)
+        it = it->second.use_count() == 1 ? map.erase(it) : std::next(it);
+}
+
+std::shared_ptr<const std::vector<float>> ProfileCache::getEnvelope(Envelope shape, int duration)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &envelope = envelopes[std::make_pair(shape, duration)];
+
+    if (envelope)
+        return envelope;
+
+    if (envelopes.size() > maxSize)
+        evict(envelopes);
+
+    auto value = std::make_shared<std::vector<float>>(duration);
+
+    for (int t = 0; t < duration; t++)
+    {
+        if (shape == Envelope::Ramp)
+            (*value)[t] = 0.5f * (1 - cosf(M_PI * (t + 1) / duration));
+        else
+            (*value)[t] = 0.5f * (1 - cosf(2 * M_PI * (t + 0.5f) / duration));
+    }
+
+    envelope = value;
+    return envelope;
+}
+
+std::shared_ptr<const SpatialProfile> ProfileCache::getProfile(int n, float position, float width, Interpolation type)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &profile = profiles[std::make_tuple(n, position, width, type)];
+
+    if (profile)
+        return profile;
+
+    if (profiles.size() > maxSize)
+        evict(profiles);
+
+    auto value = std::make_shared<SpatialProfile>();
+    value->position = position;
+    value->width = width;
+    value->type = type;
+
+    // A raised cosine over the points strictly within half the width of the
+    // center, kept on the inner points like a single point.
+    float center = position * n;
+    float radius = 0.5f * width * n;
+    float sum = 0;
+
+    if (radius > 0)
+    {
+        value->index = std::max<int>(2, floor(center - radius) + 1);
+        int end = std::min<int>(n - 2, ceil(center + radius));
+
+        for (int i = value->index; i < end; i++)
+        {
+            value->weights.push_back(0.5f * (1 + cosf(M_PI * (i - center) / radius)));
+            sum += value->weights.back();
+        }
+    }
+
+    if (value->weights.size() >= 2)
+    {
+        for (auto &w : value->weights)
+            w /= sum;
+    }
+    else
+    {
+        // Narrower than the grid, so interpolate a single point instead.
+        ExcitationPoint point;
+        point.setPosition(position, n, type);
+        value->index = point.index;
+        value->weights.assign(point.weights, point.weights + point.taps);
+    }
+
+    profile = value;
+    return profile;
+}
+
+int ProfileCache::getSize()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return profiles.size() + envelopes.size();
+}
+
+Excitations::Excitations(int n, float sampleRate) :
+    n(n),
+    sampleRate(sampleRate)
+{
+    // Reserve some slots, such that plucking and striking rarely allocate.
+    hammers.reserve(maxHammers);
+    prescribed.reserve(maxPrescribed);
+    cache = std::make_shared<ProfileCache>();
+    frets = std::make_shared<const FretTable>(StringParameters(), 1 / sampleRate, n);
+    finger.point.setGridSize(n);
+}
+
+int Excitations::addBow(float position, Interpolation type)
+{
+    bows.push_back(Bow());
+    bows.back().point.setPosition(position, n, type);
+    bows.back().friction.setSampleRate(sampleRate);
+    return bows.size() - 1;
+}
+
+void Excitations::applyPrescribed(SparseForces &f, float h)
+{
+    for (auto &p : prescribed)
+    {
+        if (p.isActive())
+            p.profile->spread(f, (1 / h) * p.next());
+    }
+
+    if (input.isActive())
+        input.profile->spread(f, (1 / h) * input.next());
+}
+
+void Excitations::draw()
+{
+#ifdef PAL
+    const char *frictionModels[] = {"Exponential", "Tabulated", "Hyperbolic", "Thermal"};
+
+    for (int i = 0; i < bows.size(); i++)
+    {
+        Bow &bow = bows[i];
+        float position = bow.point.getPosition();
+
+        ImGui::PushID(i);
+        ImGui::SliderFloat("Bowing force", &bow.fb, 0, 100);
+
+        if (ImGui::SliderFloat("Bowing position", &position, 0, 1))
+        {
+            bow.point.setPosition(position);
+        }
+
+        ImGui::Combo("Friction model", (int *)&bow.model, frictionModels, IM_ARRAYSIZE(frictionModels));
+        ImGui::Text("Bow solver: %.2f iterations/sample, peak %i", bow.friction.getAverageIterations(), bow.friction.getPeakIterations());
+        ImGui::PopID();
+    }
+
+    if (!hammers.empty())
+    {
+        Hammer &hammer = hammers[lastHammer];
+        ImGui::SliderFloat("Hammer mass", &hammer.mass, 0.1, 10);
+        ImGui::SliderFloat("Felt exponent", &hammer.exponent, 1, 4);
+        ImGui::Text("Hammer solver: %.2f iterations/sample, peak %i", hammer.telemetry.getAverageIterations(), hammer.telemetry.peakIterations);
+    }
+#endif
+}
+
+bool Excitations::hasFeedback() const
+{
+    if (finger.isActive())
+        return true;
+
+    for (const auto &bow : bows)
+    {
+        if (bow.fb != 0)
+            return true;
+    }
+
+    for (const auto &hammer : hammers)
+    {
+        if (hammer.isActive())
+            return true;
+    }
+
+    return false;
+}
+
+void Excitations::hammer(float position, float velocity, Interpolation type)
+{
+    // Keep the felt of the hammer struck last, and never allocate past the
+    // reserved hammers.
+    auto it = std::find_if(hammers.begin(), hammers.end(), [](const Hammer &h) { return !h.isActive(); });
+
+    if (it == hammers.end() && hammers.size() < maxHammers)
+    {
+        hammers.push_back(hammers.empty() ? Hammer() : hammers[lastHammer]);
+        it = hammers.end() - 1;
+    }
+    else if (it == hammers.end())
+    {
+        it = std::max_element(hammers.begin(), hammers.end(),
+            [](const Hammer &a, const Hammer &b) { return a.getTime() < b.getTime(); });
+    }
+
+    it->point.setPosition(position, n, type);
+    it->start(velocity);
+    lastHammer = it - hammers.begin();
+}
+
+bool Excitations::isActive() const
+{
+    if (hasFeedback())
+        return true;
+
+    for (const auto &p : prescribed)
+    {
+        if (p.isActive())
+            return true;
+    }
+
+    if (input.isActive())
+        return true;
+
+    return false;
+}
+
+void Excitations::pluck(float position, float force, float duration, float width, Interpolation type)
+{
+    start(Envelope::Ramp, position, force, duration, width, type);
+}
+
+void Excitations::prescribe(
+    const std::shared_ptr<const SpatialProfile> &profile,
+    const std::shared_ptr<const std::vector<float>> &envelope,
+    float force)
+{
+    auto it = std::find_if(prescribed.begin(), prescribed.end(), [](const PrescribedForce &p) { return !p.isActive(); });
+
+    if (it == prescribed.end() && prescribed.size() < maxPrescribed)
+    {
+        prescribed.push_back(PrescribedForce());
+        it = prescribed.end() - 1;
+    }
+    else if (it == prescribed.end())
+    {
+        it = std::max_element(prescribed.begin(), prescribed.end(),
+            [](const PrescribedForce &a, const PrescribedForce &b) { return a.time < b.time; });
+    }
+
+    it->profile = profile;
+    it->envelope = envelope;
+    it->force = force;
+    it->time = 0;
+}
+
+void Excitations::removeBow(int i)
+{
+    bows.erase(bows.begin() + i);
+}
+
+void Excitations::reset()
+{
+    for (auto &p : prescribed)
+        p.envelope = nullptr;
+
+    for (auto &hammer : hammers)
+        hammer.stop();
+
+    input.length = 0;
+
+    for (auto &bow : bows)
+        bow.friction.reset();
+}
+
+void Excitations::routeInput(float position, float gain, float width, Interpolation type)
+{
+    routeInput(gain != 0 ? cache->getProfile(n, position, width, type) : nullptr, gain);
+}
+
+void Excitations::routeInput(const std::shared_ptr<const SpatialProfile> &profile, float gain)
+{
+    input.profile = profile;
+    input.gain = gain;
+}
+
+void Excitations::setInput(const float *in, int numFrames, int numChannels, int channel)
+{
+    input.buffer = in ? in + channel : nullptr;
+    input.stride = numChannels;
+    input.length = in ? numFrames : 0;
+    input.time = 0;
+}
+
+void Excitations::setGridSize(int value)
+{
+    n = value;
+
+    for (auto &bow : bows)
+        bow.point.setGridSize(n);
+
+    for (auto &hammer : hammers)
+        hammer.point.setGridSize(n);
+
+    finger.point.setGridSize(n);
+
+    for (auto &p : prescribed)
+    {
+        if (p.profile)
+            p.profile = cache->getProfile(n, p.profile->position, p.profile->width, p.profile->type);
+    }
+
+    if (input.profile)
+        input.profile = cache->getProfile(n, input.profile->position, input.profile->width, input.profile->type);
+}
+
+void Excitations::start(Envelope shape, float position, float force, float duration, float width, Interpolation type)
+{
+    prescribe(cache->getProfile(n, position, width, type),
+        cache->getEnvelope(shape, std::max(1, (int)(duration * sampleRate))), force);
+}
+
+void Excitations::stopAt(float frequency)
+{
+    float position = getFrets()->getPosition(frequency);
+
+    if (position < 1)
+        stop(position);
+    else
+        lift();
+}
+
+void Excitations::strike(float position, float force, float duration, float width, Interpolation type)
+{
+    start(Envelope::Pulse, position, force, duration, width, type);
+}
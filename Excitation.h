@@ -0,0 +1,782 @@
+#pragma once
+
+#include "BowFriction.h"
+#include "StringKernel.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+/// How the state is read at, and a force spread from, a fractional position.
+enum class Interpolation
+{
+    Linear,     // Two points.
+    Cubic       // Four points, using Lagrange interpolation.
+};
+
+/// A fractional position on the string, with the weights used to read the
+/// state at and spread a force from that position precomputed whenever the
+/// position changes.
+class ExcitationPoint
+{
+    public:
+    /// Get how far a force density spread at the position moves it in the
+    /// next time step, per unit of force density.
+    /// @param  c   The folded coefficients of the string.
+    template <typename Coefficients>
+    float getForceWeight(const Coefficients &c) const
+    {
+        float g = 0;
+
+        for (int j = 0; j < taps; j++)
+            g += weights[j] * weights[j] * stiffStringForceWeight(c, index + j);
+
+        return g;
+    }
+
+    /// Get the position as a fraction of the string length.
+    float getPosition() const { return position; };
+
+    /// Read a state at the position.
+    /// @param  v   The state to read.
+    /// @returns    The interpolated value.
+    template <typename State>
+    float read(const State &v) const
+    {
+        float y = 0;
+
+        for (int j = 0; j < taps; j++)
+            y += weights[j] * v[index + j];
+
+        return y;
+    }
+
+    /// Predict the value at the position after the next time step, from the
+    /// forces applied so far. The scheme is linear, so this is the
+    /// interpolated update of the points touched.
+    /// @param  c   The folded coefficients of the string.
+    /// @param  u   The current state.
+    /// @param  up  The previous state.
+    /// @param  f   The forces applied this time step.
+    template <typename Coefficients, typename State>
+    float predict(const Coefficients &c, const State &u, const State &up, const SparseForces &f) const
+    {
+        float y = 0;
+
+        for (int j = 0; j < taps; j++)
+        {
+            int i = index + j;
+            y += weights[j] * (stiffStringRow(c, u, up, i) + stiffStringForceWeight(c, i) * f.at(i));
+        }
+
+        return y;
+    }
+
+    /// Set the position.
+    /// @param  value   The position as a fraction of the string length.
+    /// @param  n       The number of points in the string.
+    /// @param  type    The interpolation to use.
+    void setPosition(float value, int n, Interpolation type);
+
+    /// Set the position, keeping the number of points and interpolation.
+    /// @param  value   The position as a fraction of the string length.
+    void setPosition(float value) { setPosition(value, n, type); };
+
+    /// Move the point to a grid with a different number of points, keeping
+    /// its position and interpolation.
+    /// @param  value   The number of points in the string.
+    void setGridSize(int value) { setPosition(position, value, type); };
+
+    /// Spread a force density onto the string.
+    /// @param  forces  The forces of the string.
+    /// @param  force   The force density to spread.
+    void spread(SparseForces &forces, float force) const
+    {
+        for (int j = 0; j < taps; j++)
+            forces.add(index + j, weights[j] * force);
+    }
+
+    int index = 2;          // The first point touched.
+    int taps = 0;           // The number of points touched.
+    float weights[4] = {0, 0, 0, 0};
+    float norm = 0;         // The sum of the squared weights.
+
+    private:
+    float position = 0;
+    int n = 0;
+    Interpolation type = Interpolation::Linear;
+};
+
+/// A bow, with its own position, parameters and friction.
+class Bow
+{
+    public:
+    float vb = 0.2;     // Bow speed.
+    float a = 100;      // Friction characteristic.
+    float fb = 0.5;     // Bowing force.
+    FrictionModel model = FrictionModel::Tabulated;  // Friction law.
+
+    ExcitationPoint point;
+    BowFriction friction;
+
+    /// Solve for the force of the bow on the string.
+    /// @param  c   The folded coefficients of the string.
+    /// @param  u   The current state.
+    /// @param  up  The previous state.
+    /// @param  f   The forces already applied this time step.
+    /// @param  k   The sample period.
+    /// @param  h   The grid spacing.
+    /// @returns    The force the bow exerts on the string.
+    template <typename Coefficients, typename State>
+    float computeForce(
+        const Coefficients &c,
+        const State &u,
+        const State &up,
+        const SparseForces &f,
+        float k,
+        float h);
+};
+
+/// A piano hammer: a mass thrown at the string, with a felt whose force grows
+/// as a power of its compression, F = K compression^p.
+///
+/// The contact force is solved every time step from the compression before
+/// and after it, in the form that conserves the energy of the felt, which
+/// stays stable however stiff the felt. That leaves one scalar equation with
+/// an increasing left side, solved by Newton-Raphson warm started from the
+/// last compression and kept inside a bracket of the root, such that it
+/// converges within a fixed number of iterations. The hammer stops once it
+/// has bounced off the string, after which it costs nothing.
+class Hammer
+{
+    public:
+    float mass = 1;             // The mass, relative to that of the string.
+    float stiffness = 1e12;     // The felt stiffness K.
+    float exponent = 2.5;       // The felt exponent p.
+    int maxIterations = 8;      // The most Newton-Raphson iterations per time
+                                // step.
+
+    ExcitationPoint point;
+    FrictionTelemetry telemetry;
+
+    /// Get the number of time steps since the hammer was thrown.
+    int getTime() const { return time; };
+
+    /// Check whether the hammer is flying into or touching the string.
+    bool isActive() const { return active; };
+
+    /// Solve for the force of the hammer on the string, and move the hammer.
+    /// @param  c   The folded coefficients of the string.
+    /// @param  u   The current state.
+    /// @param  up  The previous state.
+    /// @param  f   The forces already applied this time step.
+    /// @param  k   The sample period.
+    /// @param  h   The grid spacing.
+    /// @returns    The force the hammer exerts on the string.
+    template <typename Coefficients, typename State>
+    float computeForce(
+        const Coefficients &c,
+        const State &u,
+        const State &up,
+        const SparseForces &f,
+        float k,
+        float h);
+
+    /// Throw the hammer at the string, starting from where the string is.
+    /// @param  value   The velocity of the hammer.
+    void start(float value);
+
+    /// Stop the hammer.
+    void stop() { active = false; };
+
+    private:
+    /// Solve r = a - b F for the compression r after the time step, where F
+    /// is the felt force between the compressions rp and r.
+    /// @param  a   The compression without the contact.
+    /// @param  b   How much the force closes the compression.
+    /// @param  rp  The compression before the time step.
+    /// @returns    The force F.
+    double solve(double a, double b, double rp);
+
+    /// Compute the felt force between two compressions and its derivative
+    /// with respect to the latter.
+    /// @param  r       The compression after the time step.
+    /// @param  rp      The compression before the time step.
+    /// @param  force   Set to the force.
+    /// @param  slope   Set to the derivative.
+    void felt(double r, double rp, double &force, double &slope) const;
+
+    double x = 0;           // The position of the hammer.
+    double xp = 0;          // The previous position of the hammer.
+    double r = 0;           // The compression of the felt.
+    float velocity = 0;     // The initial velocity.
+    int time = 0;           // The time steps since the hammer was thrown.
+    bool active = false;
+    bool started = false;   // Whether the hammer has been placed.
+};
+
+/// A finger or fret stopping the string: a stiff spring with a damper that
+/// holds the string at rest at a fractional position, such that the part on
+/// one side sounds as a shorter string. Moving the finger only moves the
+/// point it acts at, so notes change legato on a grid of fixed size.
+///
+/// The spring acts on the mean of the displacement before and after the time
+/// step, and the damper on the velocity between them, which keeps the
+/// constraint stable however stiff. The force then follows from the update
+/// without the finger in closed form. The part beyond the finger rings on at
+/// its own pitch, damped by the finger.
+class Finger
+{
+    public:
+    float stiffness = 1e10;     // The spring stiffness.
+    float damping = 1e3;        // The damper coefficient.
+
+    ExcitationPoint point;
+
+    /// Solve for the force of the finger on the string.
+    /// @param  c   The folded coefficients of the string.
+    /// @param  u   The current state.
+    /// @param  up  The previous state.
+    /// @param  f   The forces already applied this time step.
+    /// @param  k   The sample period.
+    /// @param  h   The grid spacing.
+    /// @returns    The force the finger exerts on the string.
+    template <typename Coefficients, typename State>
+    float computeForce(
+        const Coefficients &c,
+        const State &u,
+        const State &up,
+        const SparseForces &f,
+        float k,
+        float h) const;
+
+    /// Check whether the finger is stopping the string.
+    bool isActive() const { return active; };
+
+    /// Lift the finger off the string.
+    void lift() { active = false; };
+
+    /// Stop the string at a position, moving the finger there if it is
+    /// already down.
+    /// @param  position    The position as a fraction of the string length.
+    void press(float position)
+    {
+        point.setPosition(position);
+        active = true;
+    };
+
+    private:
+    bool active = false;
+};
+
+/// The pitch of a string stopped by a finger at each position, as the scheme
+/// plays it, including the stiffness and the grid. A finger pins a point of
+/// the string, but the string still bends across it, so the stopped part is
+/// tuned like neither a shorter string with free ends nor a clamped one.
+/// Instead, each entry is the eigenvalue of the pinned string closest to
+/// that of the shorter string, found from the known modes of the whole
+/// string. A table never changes the string it is for, so strings with the
+/// same wave speed and stiffness can share one, and a string whose
+/// parameters change is given a new one. It is filled once, by the first
+/// lookup, such that strings never fingered cost nothing. The lookups can be
+/// made from any thread, but the first one is slow, so it is best made off
+/// the audio thread.
+class FretTable
+{
+    public:
+    /// Create the table of a string, with simply supported ends and a rigid
+    /// finger of linear interpolation.
+    /// @param  params  The parameters of the string.
+    /// @param  k       The sample period.
+    /// @param  n       The number of points in the string.
+    FretTable(const StringParameters &params, float k, int n);
+
+    /// Get the fundamental frequency with the finger at a position.
+    /// @param  position    The position as a fraction of the string length.
+    float getFrequency(float position) const;
+
+    /// Get the fundamental frequency of the string without the finger.
+    float getOpenFrequency() const;
+
+    /// Get where to put the finger for a fundamental frequency, limited to
+    /// the positions in the table.
+    /// @param  frequency   The frequency.
+    /// @returns            The position as a fraction of the string length,
+    ///                     or 1 if the frequency is that of the open string
+    ///                     or lower.
+    float getPosition(float frequency) const;
+
+    /// Check whether the table is for a string.
+    /// @param  params  The parameters of the string.
+    /// @param  k       The sample period.
+    /// @param  n       The number of points in the string.
+    bool matches(const StringParameters &params, float k, int n) const;
+
+    static constexpr int size = 256;
+    static constexpr float minPosition = 0.1;  // The shortest stopped part.
+
+    private:
+    /// Fill the table unless it has been filled.
+    void fill() const;
+
+    /// Convert an eigenvalue of the scheme to a frequency.
+    /// @param  lambda  The eigenvalue.
+    float frequency(double lambda) const;
+
+    /// Find the eigenvalue of the pinned string between two eigenvalues of
+    /// the whole string, at which the response at the finger vanishes.
+    /// @param  m       The lower of the two eigenvalues, by index.
+    /// @param  guess   Where to start.
+    double solve(int m, double guess) const;
+
+    /// Fill the table.
+    void tabulate() const;
+
+    // Filled by the first lookup.
+    mutable std::vector<float> frequencies; // At evenly spaced positions
+                                            // from `minPosition` to the far
+                                            // end.
+    mutable std::vector<double> modes;      // The eigenvalues of the whole
+                                            // string.
+    mutable std::vector<double> coupling;   // How much each mode moves the
+                                            // finger.
+    mutable std::once_flag filled;
+
+    StringParameters params;
+    float k = 0;
+    int n = 0;
+};
+
+/// How a force is spread over the points around a fractional position: a
+/// raised cosine of a given width, or the interpolation weights of a single
+/// point if the width is zero or too narrow for the grid.
+struct SpatialProfile
+{
+    float position = 0;     // The center as a fraction of the string length.
+    float width = 0;        // The width as a fraction of the string length.
+    Interpolation type = Interpolation::Linear;
+
+    int index = 2;                  // The first point touched.
+    std::vector<float> weights;     // The weights, summing to one.
+
+    /// Spread a force density onto the string.
+    /// @param  forces  The forces of the string.
+    /// @param  force   The force density to spread.
+    void spread(SparseForces &forces, float force) const
+    {
+        for (int j = 0; j < weights.size(); j++)
+            forces.add(index + j, weights[j] * force);
+    }
+};
+
+/// The shape of the force of a pluck or strike over time.
+enum class Envelope
+{
+    Ramp,   // A raised cosine rising to one, after which the string is
+            // released.
+    Pulse   // A raised cosine pulse.
+};
+
+/// Spatial profiles and envelopes, computed once and shared by all plucks and
+/// strikes that use them, such that repeated plucks only look them up. A miss
+/// allocates, so a string running on the audio thread is best given its
+/// profiles made on another thread, see `Excitations::prescribe`. The cache
+/// holds on to all it hands out, so a pluck dropping its profile never frees
+/// it, and once it holds `maxSize` of either frees those no pluck uses.
+class ProfileCache
+{
+    public:
+    /// Get an envelope, computing it if it is not cached.
+    /// @param  shape       The shape.
+    /// @param  duration    The length in samples.
+    std::shared_ptr<const std::vector<float>> getEnvelope(Envelope shape, int duration);
+
+    /// Get a spatial profile, computing it if it is not cached.
+    /// @param  n           The number of points in the string.
+    /// @param  position    The center as a fraction of the string length.
+    /// @param  width       The width as a fraction of the string length.
+    /// @param  type        The interpolation to use if the profile is a
+    ///                     single point.
+    std::shared_ptr<const SpatialProfile> getProfile(int n, float position, float width, Interpolation type);
+
+    /// Get the number of cached profiles and envelopes.
+    int getSize();
+
+    static constexpr int maxSize = 256;
+
+    private:
+    std::map<std::tuple<int, float, float, Interpolation>, std::shared_ptr<const SpatialProfile>> profiles;
+    std::map<std::pair<Envelope, int>, std::shared_ptr<const std::vector<float>>> envelopes;
+    std::mutex mutex;
+};
+
+/// A pluck or strike: a force following an envelope, spread with a spatial
+/// profile. Neither depends on the state of the string.
+struct PrescribedForce
+{
+    std::shared_ptr<const SpatialProfile> profile;
+    std::shared_ptr<const std::vector<float>> envelope;
+    float force = 0;
+    int time = 0;
+
+    bool isActive() const { return envelope && time < envelope->size(); };
+
+    float next() { return force * (*envelope)[time++]; };
+};
+
+/// An audio input driving the string as a force, read straight from the
+/// interleaved input buffer of the audio callback.
+struct InputForce
+{
+    std::shared_ptr<const SpatialProfile> profile;
+    float gain = 0;                 // The force per unit of input.
+    const float *buffer = nullptr;  // The first sample of the input channel.
+    int stride = 1;                 // The number of channels in the buffer.
+    int length = 0;                 // The number of frames in the buffer.
+    int time = 0;
+
+    bool isActive() const { return profile && time < length; };
+
+    float next() { return gain * buffer[(time++) * stride]; };
+};
+
+/// The set of bows, hammers, plucks and strikes exciting a string, and the
+/// finger stopping it. Each touches only the points around its position, so
+/// its cost is independent of the size of the string.
+class Excitations
+{
+    public:
+    /// Create an empty set of excitations.
+    /// @param  n           The number of points in the string.
+    /// @param  sampleRate  The sample rate of the string.
+    Excitations(int n, float sampleRate = 44100);
+
+    /// Add a bow to the string.
+    /// @param  position    The bow position as a fraction of the string length.
+    /// @param  type        The interpolation to use.
+    /// @returns            The index of the new bow.
+    int addBow(float position = 0.17, Interpolation type = Interpolation::Linear);
+
+    /// Compute the forces of all excitations for the coming time step and
+    /// spread them onto the string.
+    /// @param  c   The folded coefficients of the string.
+    /// @param  u   The current state.
+    /// @param  up  The previous state.
+    /// @param  f   The forces to add to.
+    /// @param  k   The sample period.
+    /// @param  h   The grid spacing.
+    template <typename Coefficients, typename State>
+    void apply(
+        const Coefficients &c,
+        const State &u,
+        const State &up,
+        SparseForces &f,
+        float k,
+        float h);
+
+    /// Compute the forces of the excitations that do not depend on the state
+    /// of the string, which are all but the bows, for the coming time step.
+    /// @param  f   The forces to add to.
+    /// @param  h   The grid spacing.
+    void applyPrescribed(SparseForces &f, float h);
+
+    /// Draw a UI for controlling the bows.
+    void draw();
+
+    /// Get the finger stopping the string.
+    Finger &getFinger() { return finger; };
+
+    /// Get the table mapping the position of the finger to pitch, which the
+    /// string keeps up to date with its parameters. It can be called from
+    /// any thread.
+    std::shared_ptr<const FretTable> getFrets() const { return std::atomic_load(&frets); };
+
+    /// Get the hammer that last struck the string.
+    Hammer &getHammer() { return hammers[lastHammer]; };
+
+    /// Strike the string with a piano hammer. A stopped hammer is reused, or
+    /// the oldest once there are `maxHammers`.
+    /// @param  position    Where to strike as a fraction of the string length.
+    /// @param  velocity    The velocity of the hammer.
+    /// @param  type        The interpolation to use.
+    void hammer(float position, float velocity, Interpolation type = Interpolation::Linear);
+
+    /// Get a bow.
+    /// @param  i   The index of the bow.
+    Bow &getBow(int i) { return bows[i]; };
+
+    /// Get the number of bows.
+    int getNumBows() const { return bows.size(); };
+
+    /// Get the audio input routed into the string.
+    const InputForce &getInput() const { return input; };
+
+    /// Get the cache of the profiles of plucks and strikes.
+    ProfileCache &getProfileCache() { return *cache; };
+
+    /// Check whether any excitation is still driving the string: a bow with
+    /// a force, a hammer, or a pluck or strike that has not finished.
+    bool isActive() const;
+
+    /// Check whether any excitation depends on the state of the string, in
+    /// which case the forces can not be known in advance. A hammer only does
+    /// while it is active, and a finger while it is down.
+    bool hasFeedback() const;
+
+    /// Pluck or strike the string with a profile and envelope from the
+    /// cache, which unlike `pluck` and `strike` never allocates, such that
+    /// they can be looked up off the audio thread. A finished pluck or
+    /// strike is reused, or the oldest once there are `maxPrescribed`.
+    /// @param  profile     The spatial profile, made for the grid size.
+    /// @param  envelope    The envelope.
+    /// @param  force       The force scaling the envelope.
+    void prescribe(
+        const std::shared_ptr<const SpatialProfile> &profile,
+        const std::shared_ptr<const std::vector<float>> &envelope,
+        float force);
+
+    /// Pluck the string, pulling it with a force that rises as a raised
+    /// cosine until it is released.
+    /// @param  position    Where to pluck as a fraction of the string length.
+    /// @param  force       The force at the moment of release.
+    /// @param  duration    The time until release in seconds.
+    /// @param  width       The width of the finger as a fraction of the
+    ///                     string length, 0 for a single point.
+    /// @param  type        The interpolation to use for a single point.
+    void pluck(
+        float position,
+        float force,
+        float duration = 0.005,
+        float width = 0,
+        Interpolation type = Interpolation::Linear);
+
+    /// Lift the finger off the string, letting the whole string sound.
+    void lift() { finger.lift(); };
+
+    /// Remove a bow.
+    /// @param  i   The index of the bow.
+    void removeBow(int i);
+
+    /// Route an audio input into the string as a force. The input of each
+    /// block is given with `setInput`.
+    /// @param  position    Where to apply the force as a fraction of the
+    ///                     string length.
+    /// @param  gain        The force per unit of input, 0 to stop routing.
+    /// @param  width       The width of the force as a fraction of the string
+    ///                     length, 0 for a single point.
+    /// @param  type        The interpolation to use for a single point.
+    void routeInput(
+        float position,
+        float gain,
+        float width = 0,
+        Interpolation type = Interpolation::Linear);
+
+    /// Route an audio input into the string with a profile from the cache,
+    /// which unlike the above never allocates, such that the profile can be
+    /// looked up off the audio thread.
+    /// @param  profile     The spatial profile, made for the grid size, or
+    ///                     null to stop routing.
+    /// @param  gain        The force per unit of input.
+    void routeInput(const std::shared_ptr<const SpatialProfile> &profile, float gain);
+
+    /// Stop all plucks, strikes and hammers, drop the rest of the input and
+    /// reset the bow solvers. The finger stays where it is.
+    void reset();
+
+    /// Set the input of the coming block, which is read in place one frame
+    /// per time step, so the buffer must stay valid until the block is done.
+    /// @param  in          The interleaved input, or null if there is none.
+    /// @param  numFrames   The number of frames in the input.
+    /// @param  numChannels The number of channels per frame.
+    /// @param  channel     The channel to read.
+    void setInput(const float *in, int numFrames, int numChannels, int channel = 0);
+
+    /// Set the fret table, such as one shared with other strings with the
+    /// same wave speed and stiffness through their `StringTables`.
+    /// @param  value   The table.
+    void setFrets(const std::shared_ptr<const FretTable> &value) { std::atomic_store(&frets, value); };
+
+    /// Set the number of points in the string, moving all excitations to the
+    /// new grid.
+    /// @param  value   The number of points.
+    void setGridSize(int value);
+
+    /// Share a cache of profiles with other strings, such as the voices of
+    /// an instrument.
+    /// @param  value   The cache.
+    void setProfileCache(const std::shared_ptr<ProfileCache> &value) { cache = value; };
+
+    /// Stop the string with the finger, or move it if it is already down.
+    /// @param  position    Where to stop the string as a fraction of its
+    ///                     length, the part before it sounding.
+    void stop(float position) { finger.press(position); };
+
+    /// Stop the string with the finger such that it sounds at a frequency,
+    /// looked up in the fret table, or lift the finger for the open string.
+    /// The first lookup fills the table, so a string running on the audio
+    /// thread is best stopped at a position looked up off it.
+    /// @param  frequency   The fundamental frequency.
+    void stopAt(float frequency);
+
+    /// Strike the string with a raised cosine force pulse.
+    /// @param  position    Where to strike as a fraction of the string length.
+    /// @param  force       The peak force of the strike.
+    /// @param  duration    The duration of the strike in seconds.
+    /// @param  width       The width of the striker as a fraction of the
+    ///                     string length, 0 for a single point.
+    /// @param  type        The interpolation to use for a single point.
+    void strike(
+        float position,
+        float force,
+        float duration = 0.001,
+        float width = 0,
+        Interpolation type = Interpolation::Linear);
+
+    static constexpr int maxPrescribed = 16;    // The most plucks and strikes
+                                                // at once, past which the
+                                                // oldest is taken over.
+    static constexpr int maxHammers = 8;        // The most hammers at once,
+                                                // likewise.
+
+    private:
+    /// Start a pluck or strike, reusing a finished one if there is one.
+    /// @param  shape       The envelope shape.
+    /// @param  position    The position as a fraction of the string length.
+    /// @param  force       The force scaling the envelope.
+    /// @param  duration    The duration in seconds.
+    /// @param  width       The width as a fraction of the string length.
+    /// @param  type        The interpolation to use for a single point.
+    void start(Envelope shape, float position, float force, float duration, float width, Interpolation type);
+
+    std::vector<Bow> bows;
+    std::vector<Hammer> hammers;
+    Finger finger;
+    std::shared_ptr<const FretTable> frets;
+    std::vector<PrescribedForce> prescribed;   // The plucks and strikes.
+    InputForce input;
+    std::shared_ptr<ProfileCache> cache;
+
+    int n = 0;
+    float sampleRate = 44100;
+    int lastHammer = 0;
+};
+
+template <typename Coefficients, typename State>
+float Bow::computeForce(
+    const Coefficients &c,
+    const State &u,
+    const State &up,
+    const SparseForces &f,
+    float k,
+    float h)
+{
+    // The update at the bow before it applies any force.
+    float y = point.read(u);
+    float yp = point.read(up);
+    float L = point.predict(c, u, up, f);
+
+    // How much the bow force moves the string at the bow.
+    float g = (1 / h) * point.getForceWeight(c);
+
+    // The relative velocity vr = (un - up) / 2k - vb, where un depends on the
+    // bow force through the friction curve.
+    float c0 = (1 / (2 * k)) * (L - yp) - vb;
+    float c1 = (1 / (2 * k)) * g * fb;
+
+    // Approximate vr using backwards difference, in case there is no previous
+    // solution to start from.
+    float guess = (1 / k) * (y - yp) - vb;
+
+    friction.setModel(model);
+    friction.setCharacteristic(a);
+    return -fb * friction.solve(c0, c1, guess);
+}
+
+template <typename Coefficients, typename State>
+float Hammer::computeForce(
+    const Coefficients &c,
+    const State &u,
+    const State &up,
+    const SparseForces &f,
+    float k,
+    float h)
+{
+    float y = point.read(u);
+    float yp = point.read(up);
+    float L = point.predict(c, u, up, f);
+
+    // How much the hammer force moves the string at the hammer.
+    float g = (1 / h) * point.getForceWeight(c);
+
+    if (!started)
+    {
+        x = y;
+        xp = y - velocity * k;
+        r = x - y;
+        started = true;
+    }
+
+    // The hammer flies on as M (xn - 2 x + xp) / k^2 = -F, while the string
+    // moves to L + g F.
+    double k2 = (double)k * k;
+    double free = 2 * x - xp;
+    double force = solve(free - L, k2 / mass + g, xp - yp);
+
+    xp = x;
+    x = free - k2 / mass * force;
+    time++;
+
+    // Stop once out of contact and flying away from the string.
+    if (force <= 0 && x <= xp)
+        active = false;
+
+    return force;
+}
+
+template <typename Coefficients, typename State>
+float Finger::computeForce(
+    const Coefficients &c,
+    const State &u,
+    const State &up,
+    const SparseForces &f,
+    float k,
+    float h) const
+{
+    float yp = point.read(up);
+    float L = point.predict(c, u, up, f);
+    float g = (1 / h) * point.getForceWeight(c);
+
+    // F = -K (un + up) / 2 - R (un - up) / 2k, where un = L + g F.
+    float spring = 0.5f * stiffness;
+    float damper = (1 / (2 * k)) * damping;
+    return -(spring * (L + yp) + damper * (L - yp)) / (1 + g * (spring + damper));
+}
+
+template <typename Coefficients, typename State>
+void Excitations::apply(
+    const Coefficients &c,
+    const State &u,
+    const State &up,
+    SparseForces &f,
+    float k,
+    float h)
+{
+    applyPrescribed(f, h);
+
+    if (finger.isActive())
+        finger.point.spread(f, (1 / h) * finger.computeForce(c, u, up, f, k, h));
+
+    for (auto &hammer : hammers)
+    {
+        if (hammer.isActive())
+            hammer.point.spread(f, (1 / h) * hammer.computeForce(c, u, up, f, k, h));
+    }
+
+    // Bows are solved last, such that each sees the forces applied before it.
+    for (auto &bow : bows)
+    {
+        if (bow.fb != 0)
+            bow.point.spread(f, (1 / h) * bow.computeForce(c, u, up, f, k, h));
+    }
+}
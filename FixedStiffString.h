@@ -0,0 +1,314 @@
+#pragma once
+
+#include "Excitation.h"
+#include "Float16.h"
+#include "Pickup.h"
+#include "StringKernel.h"
+#include "StringModel.h"
+#include "StringTables.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+
+#ifdef PAL
+#include "pal/imgui/imgui.h"
+#endif
+
+/// A stiff string whose size, boundary condition and scalar type are fixed at
+/// compile time. Knowing these lets the compiler fold the grid spacing and
+/// boundary handling and fully unroll and vectorize the update.
+///
+/// @tparam N       The number of points in the string, at least 5.
+/// @tparam BC      The boundary condition at both ends.
+/// @tparam Real    The scalar type of the arithmetic (`float` or `double`).
+/// @tparam Storage The scalar type of the state. A state narrower than `Real`,
+///                 such as `Half` or `BFloat16` for large voice banks, is kept
+///                 in increment form (see `stiffStringIncrementStep`).
+///
+/// The string computes its own coefficients when its parameters are set, as
+/// they are a handful of numbers. Given shared `StringTables`, such as by a
+/// pool of voices, it takes them up instead, like `StiffString`, at the start
+/// of the next block or sample it computes.
+template <int N, BoundaryCondition BC, typename Real = float, typename Storage = Real>
+class FixedStiffString : public StringModel
+{
+    static_assert(N >= 5, "A stiff string needs at least five points.");
+
+    // Whether the state is kept as the current state and its increment, in
+    // place, rather than as three rotating states.
+    static constexpr bool incremental = sizeof(Storage) < sizeof(Real);
+
+    public:
+    /// Create a new stiff string model
+    /// @param  sampleRate  The sample rate to use (default 44100).
+    FixedStiffString(float sampleRate = 44100) :
+        excitations(N, sampleRate),
+        pickups(N),
+        k(1.0f / sampleRate),
+        changed(false)
+    {
+        u = ua.data();
+        up = ub.data();
+        un = uc.data();
+
+        reset();
+        updateCoefficients();
+
+        excitations.addBow();
+        pickups.add(0.6);
+    }
+
+    // The state pointers refer to our own arrays, so copying is not allowed.
+    FixedStiffString(const FixedStiffString &) = delete;
+    FixedStiffString &operator=(const FixedStiffString &) = delete;
+
+    void applyForce(int i, float force) override
+    {
+        f.add(i, (1 / h()) * force);
+    }
+
+    void computeForces() override
+    {
+        if (incremental)
+            excitations.apply(coeffs, current(), previous(), f, k, h());
+        else
+            excitations.apply(coeffs, u, up, f, k, h());
+    }
+
+    void draw(bool plot = true) override
+    {
+#ifdef PAL
+        excitations.draw();
+        pickups.draw();
+        ImGui::Text("Energy: %g", energy);
+
+        if (plot)
+        {
+            ImGui::PlotLines("String", &plotValue, u, N, 0, "", 0.0001, -0.0001, ImVec2(0, 120));
+        }
+#endif
+    }
+
+    void excite() override
+    {
+        // Displace a raised cosine peaking at one.
+        auto profile = excitations.getProfileCache().getProfile(N, 0.3, 0.1, Interpolation::Linear);
+        float peak = *std::max_element(profile->weights.begin(), profile->weights.end());
+
+        for (int j = 0; j < profile->weights.size(); j++)
+        {
+            // Displacing both states leaves the increment unchanged.
+            u[profile->index + j] += profile->weights[j] / peak;
+
+            if (!incremental)
+                up[profile->index + j] += profile->weights[j] / peak;
+        }
+    }
+
+    float getNext() override
+    {
+        swapTables();
+        step();
+
+        if (incremental)
+            return pickups.readMono(current(), previous(), k);
+
+        return pickups.readMono(u, up, k);
+    }
+
+    void getNext(float *frame, int numChannels) override
+    {
+        swapTables();
+        step();
+
+        if (incremental)
+            pickups.read(current(), previous(), k, frame, numChannels);
+        else
+            pickups.read(u, up, k, frame, numChannels);
+    }
+
+    float getForceGain(const ExcitationPoint &point) const override
+    {
+        return (coeffs.bf / h()) * point.norm;
+    }
+
+    Excitations &getExcitations() override { return excitations; };
+
+    float getEnergy() const override { return energy; };
+
+    const StringParameters &getParameters() const override { return params; };
+
+    Pickups &getPickups() override { return pickups; };
+
+    int getSize() const override { return N; };
+
+    float predict(const ExcitationPoint &point) const override
+    {
+        if (incremental)
+            return point.predict(coeffs, current(), previous(), f);
+
+        return point.predict(coeffs, u, up, f);
+    }
+
+    void process(float *out, int numFrames, int numChannels) override
+    {
+        swapTables();
+
+        for (int frame = 0; frame < numFrames; frame++)
+        {
+            computeForces();
+            step(frame == numFrames - 1);
+
+            if (incremental)
+                pickups.read(current(), previous(), k, out + frame * numChannels, numChannels);
+            else
+                pickups.read(u, up, k, out + frame * numChannels, numChannels);
+        }
+    }
+
+    void reset() override
+    {
+        ua.fill(0);
+        ub.fill(0);
+        uc.fill(0);
+        excitations.reset();
+        energy = 0;
+    }
+
+    void setBowForce(float value) override
+    {
+        if (excitations.getNumBows() > 0)
+        {
+            excitations.getBow(0).fb = value;
+        }
+    }
+
+    void setParameters(const StringParameters &value) override
+    {
+        params = value;
+        updateCoefficients();
+    }
+
+    void setTableCache(const std::shared_ptr<StringTableCache> &) override
+    {
+        // The string only runs on tables handed to it with `setTables`, and
+        // otherwise computes its handful of coefficients itself.
+    }
+
+    void setTables(const std::shared_ptr<const StringTables> &value) override
+    {
+        // Tables made for another grid, or for a string that is not uniform,
+        // only lend their parameters.
+        if (value->n != N || value->k != k || value->boundary != BC || value->varying)
+        {
+            setParameters(value->params);
+            return;
+        }
+
+        params = value->params;
+        std::atomic_store(&pending, value);
+        changed.store(true, std::memory_order_release);
+    }
+
+    void setWavespeedFromFreq(float freq) override
+    {
+        params.gamma0 = powf(2 * freq, 2);
+        updateCoefficients();
+    }
+
+    private:
+    /// The grid spacing, which is known at compile time.
+    static constexpr float h() { return 1.0f / N; }
+
+    static float plotValue(void *data, int i) { return ((Storage *)data)[i]; }
+
+    /// Get views of the current and previous state in increment form.
+    IncrementView<Storage> current() const { return {u, up, false}; }
+    IncrementView<Storage> previous() const { return {u, up, true}; }
+
+    /// Take up the tables set last, if any.
+    void swapTables()
+    {
+        if (!changed.load(std::memory_order_acquire))
+            return;
+
+        // The cache holds on to the tables given up, so they are not freed
+        // here.
+        changed.store(false, std::memory_order_relaxed);
+        auto next = std::atomic_exchange(&pending, std::shared_ptr<const StringTables>());
+
+        if (!next)
+            return;
+
+        tables = std::move(next);
+        coeffs = tables->getCoefficients<Real>();
+        pickups.setBridge(tables->params, h(), BC);
+        excitations.setFrets(tables->frets);
+    }
+
+    /// Advance the string one time step and clear the forces.
+    /// @param  measureEnergy   Whether to measure the energy along the way.
+    void step(bool measureEnergy = false)
+    {
+        Real e = 0;
+
+        if (incremental)
+        {
+            // Widen into the stack, which stays in cache however many
+            // strings there are.
+            std::array<Real, 2 * N> scratch;
+            stiffStringIncrementStep(coeffs, u, up, f, N, scratch.data(), measureEnergy ? &e : nullptr);
+        }
+        else
+        {
+            stiffStringStep(coeffs, u, up, f, un, N, measureEnergy ? &e : nullptr);
+
+            // Rotate the states, such that the next state becomes the current
+            // one.
+            Storage *ut = up;
+            up = u;
+            u = un;
+            un = ut;
+        }
+
+        if (measureEnergy)
+            energy = e;
+
+        f.clear();
+    }
+
+    void updateCoefficients()
+    {
+        coeffs.compute(params, k, h(), BC);
+        pickups.setBridge(params, h(), BC);
+
+        if (!excitations.getFrets()->matches(params, k, N))
+            excitations.setFrets(std::make_shared<const FretTable>(params, k, N));
+    }
+
+    std::array<Storage, N> ua;
+    std::array<Storage, N> ub;
+    std::array<Storage, incremental ? 0 : N> uc;
+
+    // In increment form `u` is the current state and `up` the increment, and
+    // `un` is not used.
+    Storage *un;    // Next state.
+    Storage *u;     // Current state.
+    Storage *up;    // Previous state.
+    SparseForces f; // Forces.
+
+    StringParameters params;
+    StringCoefficients<Real> coeffs;
+    Excitations excitations;
+    Pickups pickups;
+
+    float k = 0;        // Sample period.
+    float energy = 0;   // Energy in the last time step of a block.
+
+    // The shared tables the string runs on, if any, and those set last,
+    // which it takes up at the start of the next block or sample.
+    std::shared_ptr<const StringTables> tables;
+    std::shared_ptr<const StringTables> pending;
+    std::atomic<bool> changed;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+// 16-bit storage formats for the state of a string. Values are converted to
+// float on every load and rounded to nearest even on every store, such that
+// the scheme computes in float while moving half as many bytes. Neither type
+// supports arithmetic of its own; both decay to float.
+
+/// An IEEE 754 half-precision float, with 11 bits of precision. Its range of
+/// 6e-5 to 65504 is far from the displacements of a string, so values are
+/// stored scaled by 2^12, which moves the range to 1.5e-8 to 16.
+struct Half
+{
+    Half() = default;
+
+    Half(float value) : bits(fromFloat(value * scale)) {}
+
+    operator float() const { return toFloat(bits) * (1 / scale); }
+
+    Half &operator+=(float value)
+    {
+        *this = Half(*this + value);
+        return *this;
+    }
+
+    static constexpr float scale = 4096;
+
+    /// Round a float to the nearest half.
+    static uint16_t fromFloat(float value)
+    {
+#ifdef __F16C__
+        return _cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT);
+#else
+        uint32_t x;
+        memcpy(&x, &value, sizeof(x));
+
+        uint32_t sign = (x >> 16) & 0x8000;
+        x &= 0x7fffffff;
+
+        // Overflow to infinity, keep NaN a NaN.
+        if (x >= (143u << 23))
+            return sign | (x > (255u << 23) ? 0x7e00 : 0x7c00);
+
+        // Subnormals and zero: let the float adder align and round the
+        // mantissa.
+        if (x < (113u << 23))
+        {
+            float f;
+            uint32_t magic = 126u << 23;
+            memcpy(&f, &x, sizeof(f));
+            float g;
+            memcpy(&g, &magic, sizeof(g));
+            f += g;
+            memcpy(&x, &f, sizeof(x));
+            return sign | (x - magic);
+        }
+
+        // Normals: rebias the exponent and round to nearest even.
+        uint32_t odd = (x >> 13) & 1;
+        x += ((uint32_t)(15 - 127) << 23) + 0xfff + odd;
+        return sign | (x >> 13);
+#endif
+    }
+
+    /// Widen a half to a float, which is exact.
+    static float toFloat(uint16_t value)
+    {
+#ifdef __F16C__
+        return _cvtsh_ss(value);
+#else
+        uint32_t x = (uint32_t)(value & 0x7fff) << 13;
+        uint32_t exponent = x & (0x7c00u << 13);
+        float f;
+
+        x += (uint32_t)(127 - 15) << 23;
+
+        if (exponent == (0x7c00u << 13))
+        {
+            // Infinity or NaN.
+            x += (uint32_t)(128 - 16) << 23;
+            memcpy(&f, &x, sizeof(f));
+        }
+        else if (exponent == 0)
+        {
+            // Subnormal or zero: renormalize through the float adder.
+            uint32_t magic = 113u << 23;
+            float g;
+            x += 1u << 23;
+            memcpy(&f, &x, sizeof(f));
+            memcpy(&g, &magic, sizeof(g));
+            f -= g;
+        }
+        else
+        {
+            memcpy(&f, &x, sizeof(f));
+        }
+
+        return (value & 0x8000) ? -f : f;
+#endif
+    }
+
+    uint16_t bits;
+};
+
+/// A bfloat16, the upper half of a float, with 8 bits of precision and the
+/// full range of a float.
+struct BFloat16
+{
+    BFloat16() = default;
+
+    BFloat16(float value) : bits(fromFloat(value)) {}
+
+    operator float() const { return toFloat(bits); }
+
+    BFloat16 &operator+=(float value)
+    {
+        *this = BFloat16(*this + value);
+        return *this;
+    }
+
+    /// Round a float to the nearest bfloat16.
+    static uint16_t fromFloat(float value)
+    {
+        uint32_t x;
+        memcpy(&x, &value, sizeof(x));
+
+        // Keep NaN a NaN, rather than rounding it to infinity.
+        if ((x & 0x7fffffff) > 0x7f800000)
+            return (x >> 16) | 0x40;
+
+        x += 0x7fff + ((x >> 16) & 1);
+        return x >> 16;
+    }
+
+    /// Widen a bfloat16 to a float, which is exact.
+    static float toFloat(uint16_t value)
+    {
+        uint32_t x = (uint32_t)value << 16;
+        float f;
+        memcpy(&f, &x, sizeof(f));
+        return f;
+    }
+
+    uint16_t bits;
+};
@@ -0,0 +1,75 @@
+#include "FrictionModels.h"
+#include <algorithm>
+
+TabulatedFriction::TabulatedFriction(float a, int tableSize) :
+    phiTable(tableSize, 0),
+    phidTable(tableSize, 0)
+{
+    setCharacteristic(a);
+}
+
+void TabulatedFriction::buildExponentialTable()
+{
+    // Beyond vmax the curve is below 1e-6 of its peak value.
+    double vmax = sqrt((0.5 + log(1e6)) / a);
+    scale = (phiTable.size() - 1) / vmax;
+
+    double sqrt2a = sqrt(2.0 * a);
+
+    for (int i = 0; i < phiTable.size(); i++)
+    {
+        double v = i / scale;
+        double c = exp(-a * v * v + 0.5);
+        phiTable[i] = sqrt2a * v * c;
+        phidTable[i] = sqrt2a * (c - 2 * a * v * v * c);
+    }
+
+    // Measure the interpolation error halfway between the table points,
+    // where it is largest.
+    maxError = 0;
+
+    for (int i = 0; i < phiTable.size() - 1; i++)
+    {
+        double v = (i + 0.5) / scale;
+        float phi, phid;
+        evaluate(v, phi, phid);
+        maxError = std::max<float>(maxError, fabs(phi - sqrt2a * v * exp(-a * v * v + 0.5)));
+    }
+}
+
+void TabulatedFriction::setCharacteristic(float value)
+{
+    if (isMeasured || value == a)
+    {
+        return;
+    }
+
+    a = value;
+    buildExponentialTable();
+}
+
+bool TabulatedFriction::setCurve(const std::vector<float> &values, float vmax)
+{
+    // The slopes at zero velocity need the second value.
+    int n = values.size();
+
+    if (n < 2)
+        return false;
+
+    isMeasured = true;
+    maxError = 0;
+    scale = (n - 1) / vmax;
+    phiTable = values;
+    phidTable.resize(n);
+
+    // Estimate the slopes with finite differences, using the odd symmetry of
+    // the curve at zero velocity.
+    for (int i = 0; i < n; i++)
+    {
+        float prev = i > 0 ? values[i-1] : -values[1];
+        float next = i < n - 1 ? values[i+1] : values[i];
+        phidTable[i] = 0.5f * (next - prev) * scale;
+    }
+
+    return true;
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+// Friction models for the bow. Each model is a policy that supplies the
+// friction curve phi(vr) and its derivative through
+//
+//     void evaluate(float vr, float &phi, float &phid) const;
+//
+// and may solve vr = c0 - c1 phi(vr) directly through
+//
+//     bool solve(float c0, float c1, float &vr, float &phi) const;
+//
+// returning false when it has no direct solution, in which case
+// `solveFriction` falls back to Newton-Raphson. Models with internal state
+// advance it once per sample in
+//
+//     void update(float vr, float phi);
+//
+// All functions are resolved at compile time, so each model gets its own
+// solver without any virtual calls per sample.
+
+/// The friction models available to a bow.
+enum class FrictionModel
+{
+    Exponential,
+    Tabulated,
+    Hyperbolic,
+    Thermal,
+    NumFrictionModels
+};
+
+/// Counts the iterations spent solving for the bow velocity.
+struct FrictionTelemetry
+{
+    int lastIterations = 0;
+    int peakIterations = 0;
+    int unconvergedSolves = 0;
+    long totalIterations = 0;
+    long totalSolves = 0;
+
+    /// Get the average number of iterations per solve.
+    float getAverageIterations() const
+    {
+        return totalSolves > 0 ? (float)totalIterations / totalSolves : 0;
+    }
+
+    /// Record a solve.
+    /// @param  iterations  The number of iterations used.
+    /// @param  converged   Whether the solve converged.
+    void record(int iterations, bool converged)
+    {
+        lastIterations = iterations;
+        peakIterations = iterations > peakIterations ? iterations : peakIterations;
+        unconvergedSolves += !converged;
+        totalIterations += iterations;
+        totalSolves++;
+    }
+};
+
+/// The exponential friction curve phi(vr) = sqrt(2a) vr exp(-a vr^2 + 1/2),
+/// evaluated exactly.
+struct ExponentialFriction
+{
+    float a = 100;
+    float sqrt2a = sqrtf(200);
+
+    /// Set the friction characteristic.
+    /// @param  value   The desired friction characteristic.
+    void setCharacteristic(float value)
+    {
+        a = value;
+        sqrt2a = sqrtf(2 * a);
+    }
+
+    void evaluate(float vr, float &phi, float &phid) const
+    {
+        float vr2 = vr * vr;
+        float c = expf(-a * vr2 + 0.5f);
+        phi = sqrt2a * vr * c;
+        phid = sqrt2a * (c - 2 * a * vr2 * c);
+    }
+
+    bool solve(float, float, float &, float &) const { return false; }
+
+    void update(float, float) {}
+};
+
+/// A friction curve tabulated at positive velocities and evaluated with cubic
+/// Hermite interpolation. The table is either built from the exponential
+/// curve, or from a measured curve.
+class TabulatedFriction
+{
+    public:
+    /// Create a table of the exponential curve.
+    /// @param  a           The friction characteristic.
+    /// @param  tableSize   The number of points in the table.
+    TabulatedFriction(float a = 100, int tableSize = 512);
+
+    /// Get the largest absolute error of the table compared to the
+    /// exponential curve, measured when the table was built. Zero for
+    /// measured curves.
+    float getMaxError() const { return maxError; };
+
+    /// Set the friction characteristic, rebuilding the table if it holds the
+    /// exponential curve and the characteristic changed.
+    /// @param  value   The desired friction characteristic.
+    void setCharacteristic(float value);
+
+    /// Use a measured friction curve.
+    /// @param  values  The curve sampled uniformly from zero velocity to
+    ///                 `vmax`. The curve is assumed to be odd and to vanish
+    ///                 beyond `vmax`.
+    /// @param  vmax    The velocity of the last value.
+    /// @returns        False if there are fewer than two values, in which
+    ///                 case the curve is left unchanged.
+    bool setCurve(const std::vector<float> &values, float vmax);
+
+    void evaluate(float vr, float &phi, float &phid) const
+    {
+        float x = fabsf(vr) * scale;
+
+        // Written such that a diverged (NaN) velocity also ends up here.
+        if (!(x < phiTable.size() - 1))
+        {
+            phi = 0;
+            phid = 0;
+            return;
+        }
+
+        int i = x;
+        float t = x - i;
+        float t2 = t * t;
+        float t3 = t2 * t;
+        float d = 1 / scale;
+        float p0 = phiTable[i];
+        float p1 = phiTable[i+1];
+        float m0 = phidTable[i] * d;
+        float m1 = phidTable[i+1] * d;
+
+        float p = (2 * t3 - 3 * t2 + 1) * p0 + (t3 - 2 * t2 + t) * m0
+            + (-2 * t3 + 3 * t2) * p1 + (t3 - t2) * m1;
+        float dp = (6 * t2 - 6 * t) * p0 + (3 * t2 - 4 * t + 1) * m0
+            + (-6 * t2 + 6 * t) * p1 + (3 * t2 - 2 * t) * m1;
+
+        phi = vr < 0 ? -p : p;
+        phid = dp * scale;
+    }
+
+    bool solve(float, float, float &, float &) const { return false; }
+
+    void update(float, float) {}
+
+    private:
+    /// Tabulate the exponential curve for the current characteristic.
+    void buildExponentialTable();
+
+    float a = 0;
+    float scale = 0;    // Table points per unit of velocity.
+    bool isMeasured = false;
+
+    // The curve and its derivative at positive velocities. The curve is odd
+    // and its derivative even, so negative velocities are found by
+    // reflection.
+    std::vector<float> phiTable;
+    std::vector<float> phidTable;
+    float maxError = 0;
+};
+
+/// The hyperbolic friction law
+/// phi(vr) = sign(vr) (mud + (mus - mud) v0 / (v0 + |vr|)), with a static
+/// friction coefficient `mus` while sticking. It has a closed-form solution,
+/// so it never iterates.
+struct HyperbolicFriction
+{
+    float mus = 0.8;    // Static friction coefficient.
+    float mud = 0.3;    // Dynamic friction coefficient.
+    float v0 = 0.1;     // Velocity at which friction has decayed halfway.
+
+    void evaluate(float vr, float &phi, float &phid) const
+    {
+        float s = 1 / (v0 + fabsf(vr));
+        float p = mud + (mus - mud) * v0 * s;
+        phi = vr < 0 ? -p : p;
+        phid = -(mus - mud) * v0 * s * s;
+    }
+
+    bool solve(float c0, float c1, float &vr, float &phi) const
+    {
+        if (c1 <= 0)
+        {
+            return false;
+        }
+
+        // The bow sticks if static friction can hold the string.
+        if (fabsf(c0) <= c1 * mus)
+        {
+            vr = 0;
+            phi = c0 / c1;
+            return true;
+        }
+
+        // Otherwise it slips in the direction of c0, where the sliding
+        // velocity x = |vr| solves x^2 + (v0 - c) x + v0 (c1 (mus - mud) - c) = 0.
+        float c = fabsf(c0) - c1 * mud;
+        float b = v0 - c;
+        float d = b * b - 4 * v0 * (c1 * (mus - mud) - c);
+        float x = 0.5f * (-b + sqrtf(fmaxf(d, 0)));
+
+        float phid;
+        vr = c0 < 0 ? -x : x;
+        evaluate(vr, phi, phid);
+        return true;
+    }
+
+    void update(float, float) {}
+};
+
+/// The exponential curve scaled by a rosin temperature, which rises with the
+/// power dissipated by friction and relaxes towards ambient temperature. A
+/// hotter rosin grips less, giving the hysteresis of plastic friction.
+struct ThermalFriction
+{
+    ExponentialFriction curve;
+    float heating = 100;        // Temperature rise per unit of dissipated work.
+    float coolingTime = 0.01;   // Time constant of the cooling in seconds.
+    float softening = 1;        // How strongly temperature reduces friction.
+    float temperature = 0;      // Temperature above ambient.
+    float k = 1.0f / 44100;     // Sample period.
+
+    void evaluate(float vr, float &phi, float &phid) const
+    {
+        float scale = 1 / (1 + softening * temperature);
+        curve.evaluate(vr, phi, phid);
+        phi *= scale;
+        phid *= scale;
+    }
+
+    bool solve(float, float, float &, float &) const { return false; }
+
+    void update(float vr, float phi)
+    {
+        temperature += k * (heating * fabsf(phi * vr) - temperature / coolingTime);
+    }
+};
+
+/// Solve vr = c0 - c1 phi(vr) for the relative bow velocity, using the
+/// direct solution of the model if it has one and otherwise Newton-Raphson
+/// started at the current value of `vr`.
+/// @param  model           The friction model.
+/// @param  vr              The initial guess, overwritten by the solution.
+/// @param  c0              The relative velocity in the absence of friction.
+/// @param  c1              How strongly friction affects the velocity.
+/// @param  maxIterations   The largest number of Newton-Raphson iterations.
+/// @param  tolerance       The step size at which Newton-Raphson has converged.
+/// @param  telemetry       Where to record the number of iterations.
+/// @returns                The value of the friction curve at the solution.
+template <typename Model>
+inline float solveFriction(
+    Model &model,
+    float &vr,
+    float c0,
+    float c1,
+    int maxIterations,
+    float tolerance,
+    FrictionTelemetry &telemetry)
+{
+    float phi = 0;
+    float phid = 0;
+
+    if (model.solve(c0, c1, vr, phi))
+    {
+        telemetry.record(0, true);
+        model.update(vr, phi);
+        return phi;
+    }
+
+    float delta = INFINITY;
+    int i = 0;
+
+    for (; i < maxIterations && fabsf(delta) > tolerance; i++)
+    {
+        model.evaluate(vr, phi, phid);
+
+        float num = c0 - c1 * phi - vr;
+        float denom = -c1 * phid - 1;
+
+        delta = num / denom;
+        vr -= delta;
+    }
+
+    // Make sure the returned force matches the final velocity.
+    model.evaluate(vr, phi, phid);
+
+    telemetry.record(i, fabsf(delta) <= tolerance);
+    model.update(vr, phi);
+    return phi;
+}
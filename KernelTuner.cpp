@@ -0,0 +1,242 @@
+#include "KernelTuner.h"
+#include "ParallelSolver.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+
+KernelTuner::KernelTuner(const std::string &path, float sampleRate) :
+    path(path),
+    sampleRate(sampleRate)
+{
+    if (!path.empty())
+        load();
+}
+
+KernelChoice KernelTuner::choose(int n)
+{
+    auto cached = choices.find(n);
+
+    if (cached != choices.end())
+        return cached->second;
+
+    KernelChoice kernel = tune(n);
+
+    if (!path.empty())
+        save();
+
+    return kernel;
+}
+
+std::vector<KernelChoice> KernelTuner::getCandidates(int n) const
+{
+    std::vector<KernelChoice> candidates;
+    KernelChoice plain;
+    plain.fixed = false;
+    plain.blockSteps = 1;
+
+    if (hasFixedStiffString(n))
+        candidates.push_back(KernelChoice());
+
+    candidates.push_back(plain);
+
+    for (int tileSize : {256, 512, 1024})
+    {
+        if (n < 2 * tileSize)
+            break;
+
+        for (int steps : {2, 4, 8})
+        {
+            KernelChoice blocked = plain;
+            blocked.blockSteps = steps;
+            blocked.tileSize = tileSize;
+            candidates.push_back(blocked);
+        }
+    }
+
+    int maxThreads = std::thread::hardware_concurrency();
+
+    for (int numThreads = 2; numThreads <= std::min(maxThreads, 8); numThreads *= 2)
+    {
+        if (!ParallelStringSolver(numThreads).isWorthwhile(n))
+            break;
+
+        KernelChoice threaded = plain;
+        threaded.numThreads = numThreads;
+        candidates.push_back(threaded);
+    }
+
+    return candidates;
+}
+
+std::string KernelTuner::getCpuModel()
+{
+    std::string model = "unknown";
+
+#ifdef __APPLE__
+    char name[256];
+    size_t size = sizeof(name);
+
+    if (sysctlbyname("machdep.cpu.brand_string", name, &size, nullptr, 0) == 0)
+        model = name;
+#else
+    FILE *file = fopen("/proc/cpuinfo", "r");
+
+    if (!file)
+        return model;
+
+    char line[512];
+
+    while (fgets(line, sizeof(line), file))
+    {
+        const char *colon = strchr(line, ':');
+
+        if (strncmp(line, "model name", 10) == 0 && colon)
+        {
+            model = colon + 1 + strspn(colon + 1, " \t");
+            model.erase(model.find_last_not_of(" \t\r\n") + 1);
+            break;
+        }
+    }
+
+    fclose(file);
+#endif
+
+    return model;
+}
+
+std::string KernelTuner::getKey() const
+{
+    // The build time of this file stands for the version of the binary, as it
+    // is rebuilt along with the kernel headers it includes.
+    std::string version = "kernels " + std::to_string(kernelVersion);
+
+#ifdef __VERSION__
+    version += ", " __VERSION__;
+#endif
+
+    return getCpuModel() + "\t" + version + ", built " __DATE__ " " __TIME__;
+}
+
+bool KernelTuner::load()
+{
+    FILE *file = fopen(path.c_str(), "r");
+
+    if (!file)
+        return false;
+
+    char line[1024];
+    bool valid = fgets(line, sizeof(line), file) && strcspn(line, "\n") < strlen(line);
+
+    if (valid)
+    {
+        line[strcspn(line, "\n")] = 0;
+        valid = getKey() == line;
+    }
+
+    if (valid)
+    {
+        choices.clear();
+        int n;
+        int fixed;
+        KernelChoice kernel;
+
+        while (fscanf(file, "%i %i %i %i %i", &n, &fixed, &kernel.blockSteps, &kernel.tileSize, &kernel.numThreads) == 5)
+        {
+            kernel.fixed = fixed;
+            choices[n] = kernel;
+        }
+    }
+
+    fclose(file);
+    return valid;
+}
+
+double KernelTuner::measure(int n, const KernelChoice &kernel) const
+{
+    // Loosen the string until the grid is stable, keeping its character.
+    StringParameters params;
+
+    for (int i = 0; i < 40 && computeStableSize(params, sampleRate) < n; i++)
+    {
+        params.gamma0 /= 2;
+        params.kappa0 /= 4;
+        params.sigma1 /= 4;
+    }
+
+    auto string = makeStiffString(n, kernel, params, BoundaryCondition::SimplySupported, sampleRate);
+    string->setBowForce(0);
+
+    const int blockSize = 256;
+    const int numRuns = 3;
+    std::vector<float> out(blockSize);
+    double best = 1e9;
+
+    // Warm the caches and the threads up before the first run.
+    string->getExcitations().pluck(0.2, 10, 0.005, 0.02);
+    string->process(out.data(), blockSize, 1);
+
+    for (int run = 0; run < numRuns; run++)
+    {
+        string->getExcitations().pluck(0.2, 10, 0.005, 0.02);
+
+        auto start = std::chrono::steady_clock::now();
+        double elapsed = 0;
+        long steps = 0;
+
+        while (steps == 0 || elapsed < measureTime / numRuns)
+        {
+            string->process(out.data(), blockSize, 1);
+            steps += blockSize;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        best = std::min(best, elapsed / steps);
+    }
+
+    return best;
+}
+
+bool KernelTuner::save() const
+{
+    FILE *file = fopen(path.c_str(), "w");
+
+    if (!file)
+        return false;
+
+    fprintf(file, "%s\n", getKey().c_str());
+
+    for (auto &choice : choices)
+    {
+        const KernelChoice &kernel = choice.second;
+        fprintf(file, "%i %i %i %i %i\n", choice.first, (int)kernel.fixed, kernel.blockSteps, kernel.tileSize,
+            kernel.numThreads);
+    }
+
+    return fclose(file) == 0;
+}
+
+KernelChoice KernelTuner::tune(int n)
+{
+    KernelChoice fastest;
+    double best = 0;
+
+    for (const KernelChoice &kernel : getCandidates(n))
+    {
+        double time = measure(n, kernel);
+
+        if (best == 0 || time < best)
+        {
+            fastest = kernel;
+            best = time;
+        }
+    }
+
+    choices[n] = fastest;
+    return fastest;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "StringFactory.h"
+#include <map>
+#include <string>
+#include <vector>
+
+/// Finds the fastest stiff string kernel for each grid size on the machine it
+/// runs on, by timing all variants the first time a size is asked for, and
+/// remembers the winners in a cache file such that later runs start at once.
+///
+/// The variants are the compile-time specialization, the dynamically sized
+/// string, and the latter with temporal blocking or threading, which give the
+/// same result. The number format changes the result, so it is left to the
+/// caller. Each variant is timed plucked and without a bow, which is when
+/// blocking and threading apply.
+///
+/// The cache is a text file whose first line is the key it was measured
+/// under, the CPU model and the version of the binary, followed by a line per
+/// grid size. A cache with another key is ignored, and rewritten with the
+/// choices timed again.
+class KernelTuner
+{
+    public:
+    /// Create a tuner, loading the cache if it exists.
+    /// @param  path        The cache file, or empty to keep the choices in
+    ///                     memory only.
+    /// @param  sampleRate  The sample rate the strings run at (default 44100).
+    KernelTuner(const std::string &path = "", float sampleRate = 44100);
+
+    /// Get the fastest kernel for a grid size, timing the variants and
+    /// saving the cache if the size is not in it.
+    /// @param  n   The number of points in the string.
+    /// @returns    The fastest kernel.
+    KernelChoice choose(int n);
+
+    /// Get the variants a grid size can run on. Temporal blocking is only
+    /// tried on strings of at least two tiles, and threading with no more
+    /// threads than the machine has and enough points for each.
+    /// @param  n   The number of points in the string.
+    std::vector<KernelChoice> getCandidates(int n) const;
+
+    /// Get the model name of the CPU, or "unknown" if it cannot be read.
+    static std::string getCpuModel();
+
+    /// Get the key the cache is valid for.
+    std::string getKey() const;
+
+    /// Load the cache file, replacing the choices in memory.
+    /// @returns    False if the file is missing, unreadable or has another
+    ///             key, in which case no choices are loaded.
+    bool load();
+
+    /// Time a variant on a plucked string of a grid size.
+    /// @param  n       The number of points in the string.
+    /// @param  kernel  The variant.
+    /// @returns        The least time per time step, in seconds.
+    double measure(int n, const KernelChoice &kernel) const;
+
+    /// Save the choices to the cache file.
+    /// @returns    False if the file cannot be written.
+    bool save() const;
+
+    /// Set how long to time each variant for.
+    /// @param  value   The time in seconds, split into several runs.
+    void setMeasureTime(float value) { measureTime = value; };
+
+    /// Time all variants for a grid size and remember the fastest, without
+    /// saving the cache.
+    /// @param  n   The number of points in the string.
+    /// @returns    The fastest kernel.
+    KernelChoice tune(int n);
+
+    static constexpr int kernelVersion = 1;     // Raise whenever a kernel
+                                                // changes outside the headers.
+
+    private:
+    std::map<int, KernelChoice> choices;        // The fastest kernel per size.
+    std::string path;
+    float sampleRate = 44100;
+    float measureTime = 0.03;
+};
@@ -0,0 +1,317 @@
+#include "ParallelSolver.h"
+#include "StiffPlate.h"
+#include <algorithm>
+
+ParallelStringSolver::ParallelStringSolver(int numThreads, int maxSteps, int maxChannels) :
+    numThreads(std::max(1, numThreads)),
+    maxSteps(std::max(1, maxSteps)),
+    maxChannels(std::max(1, maxChannels)),
+    forces(this->maxSteps),
+    progress(this->numThreads),
+    outputs(this->numThreads, std::vector<float>(this->maxSteps * this->maxChannels))
+{
+    // The calling thread runs the first partition.
+    for (int p = 1; p < this->numThreads; p++)
+        workers.push_back(std::thread(&ParallelStringSolver::work, this, p));
+}
+
+ParallelStringSolver::~ParallelStringSolver()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    started.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+bool ParallelStringSolver::run(
+    const StringCoefficients<float> &c,
+    float *const *states,
+    int n,
+    int numSteps,
+    const Pickups &pickups,
+    float k,
+    float *out,
+    int numChannels,
+    float *energy)
+{
+    if (numChannels > maxChannels)
+        return false;
+
+    coeffs = &c;
+    this->states[0] = states[0];
+    this->states[1] = states[1];
+    this->states[2] = states[2];
+    this->n = n;
+    this->numSteps = std::min(numSteps, maxSteps);
+    this->pickups = &pickups;
+    this->k = k;
+    this->numChannels = numChannels;
+    measureEnergy = energy != nullptr;
+
+    for (int p = 0; p < numThreads; p++)
+    {
+        progress[p].steps.store(0, std::memory_order_relaxed);
+        progress[p].energy = 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+        running = numThreads - 1;
+    }
+
+    started.notify_all();
+    runPartition(0);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return running == 0; });
+    }
+
+    // Mix the output of all partitions.
+    std::fill(out, out + this->numSteps * numChannels, 0);
+
+    for (const auto &output : outputs)
+    {
+        for (int i = 0; i < this->numSteps * numChannels; i++)
+            out[i] += output[i];
+    }
+
+    if (energy)
+    {
+        *energy = 0;
+
+        for (const auto &partition : progress)
+            *energy += partition.energy;
+    }
+
+    for (int step = 0; step < this->numSteps; step++)
+        forces[step].clear();
+
+    return true;
+}
+
+void ParallelStringSolver::runPartition(int p)
+{
+    int lo = (long)n * p / numThreads;
+    int hi = (long)n * (p + 1) / numThreads;
+    float *frames = outputs[p].data();
+
+    std::fill(frames, frames + numSteps * numChannels, 0);
+
+    for (int step = 0; step < numSteps; step++)
+    {
+        // Wait until both neighbours have completed the previous time step,
+        // which wrote the halo this one reads.
+        if (p > 0)
+        {
+            while (progress[p - 1].steps.load(std::memory_order_acquire) < step)
+                std::this_thread::yield();
+        }
+
+        if (p < numThreads - 1)
+        {
+            while (progress[p + 1].steps.load(std::memory_order_acquire) < step)
+                std::this_thread::yield();
+        }
+
+        const float *up = states[step % 3];
+        const float *u = states[(step + 1) % 3];
+        float *un = states[(step + 2) % 3];
+
+        bool last = measureEnergy && step == numSteps - 1;
+        stiffStringRange(*coeffs, u, up, un, n, lo, hi, last ? &progress[p].energy : nullptr);
+        forces[step].applyRange(un, coeffs->bf, lo, hi);
+        pickups->accumulate((const float *)un, u, k, lo, hi, frames + step * numChannels, numChannels);
+
+        progress[p].steps.store(step + 1, std::memory_order_release);
+    }
+}
+
+void ParallelStringSolver::work(int p)
+{
+    int seen = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            started.wait(lock, [&] { return stopping || generation != seen; });
+
+            if (stopping)
+                return;
+
+            seen = generation;
+        }
+
+        runPartition(p);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (--running == 0)
+                finished.notify_one();
+        }
+    }
+}
+
+ParallelPlateSolver::ParallelPlateSolver(int numThreads, int maxSteps, int maxChannels) :
+    numThreads(std::max(1, numThreads)),
+    maxSteps(std::max(1, maxSteps)),
+    maxChannels(std::max(1, maxChannels)),
+    forces(this->maxSteps),
+    progress(this->numThreads),
+    outputs(this->numThreads, std::vector<float>(this->maxSteps * this->maxChannels))
+{
+    // The calling thread runs the first band.
+    for (int p = 1; p < this->numThreads; p++)
+        workers.push_back(std::thread(&ParallelPlateSolver::work, this, p));
+}
+
+ParallelPlateSolver::~ParallelPlateSolver()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    started.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+bool ParallelPlateSolver::run(
+    const PlateCoefficients<float> &c,
+    float *const *states,
+    int stride,
+    int nx,
+    int ny,
+    int tileWidth,
+    int numSteps,
+    const PlatePickups &pickups,
+    float k,
+    float *out,
+    int numChannels)
+{
+    if (numChannels > maxChannels)
+        return false;
+
+    coeffs = &c;
+    this->states[0] = states[0];
+    this->states[1] = states[1];
+    this->states[2] = states[2];
+    this->stride = stride;
+    this->nx = nx;
+    this->ny = ny;
+    this->tileWidth = tileWidth;
+    this->numSteps = std::min(numSteps, maxSteps);
+    this->pickups = &pickups;
+    this->k = k;
+    this->numChannels = numChannels;
+
+    for (int p = 0; p < numThreads; p++)
+        progress[p].steps.store(0, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+        running = numThreads - 1;
+    }
+
+    started.notify_all();
+    runBand(0);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return running == 0; });
+    }
+
+    // Mix the output of all bands.
+    std::fill(out, out + this->numSteps * numChannels, 0);
+
+    for (const auto &output : outputs)
+    {
+        for (int i = 0; i < this->numSteps * numChannels; i++)
+            out[i] += output[i];
+    }
+
+    for (int step = 0; step < this->numSteps; step++)
+        forces[step].clear();
+
+    return true;
+}
+
+void ParallelPlateSolver::runBand(int p)
+{
+    int y0 = (long)ny * p / numThreads;
+    int y1 = (long)ny * (p + 1) / numThreads;
+    float *frames = outputs[p].data();
+
+    // The band owns its rows of the padded state, and the ghost rows beyond
+    // them at the top and bottom edges.
+    int lo = p == 0 ? 0 : (y0 + 2) * stride;
+    int hi = p == numThreads - 1 ? (ny + 4) * stride : (y1 + 2) * stride;
+
+    std::fill(frames, frames + numSteps * numChannels, 0);
+
+    for (int step = 0; step < numSteps; step++)
+    {
+        // Wait until both neighbours have completed the previous time step,
+        // which wrote the rows this one reads.
+        if (p > 0)
+        {
+            while (progress[p - 1].steps.load(std::memory_order_acquire) < step)
+                std::this_thread::yield();
+        }
+
+        if (p < numThreads - 1)
+        {
+            while (progress[p + 1].steps.load(std::memory_order_acquire) < step)
+                std::this_thread::yield();
+        }
+
+        const float *up = states[step % 3];
+        const float *u = states[(step + 1) % 3];
+        float *un = states[(step + 2) % 3];
+
+        stiffPlateRows(*coeffs, u, up, un, stride, nx, y0, y1, tileWidth);
+        forces[step].applyRange(un, coeffs->bf, lo, hi);
+        stiffPlateGhosts(*coeffs, un, stride, nx, ny, y0, y1);
+        pickups->accumulate(un, u, k, lo, hi, frames + step * numChannels, numChannels);
+
+        progress[p].steps.store(step + 1, std::memory_order_release);
+    }
+}
+
+void ParallelPlateSolver::work(int p)
+{
+    int seen = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            started.wait(lock, [&] { return stopping || generation != seen; });
+
+            if (stopping)
+                return;
+
+            seen = generation;
+        }
+
+        runBand(p);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (--running == 0)
+                finished.notify_one();
+        }
+    }
+}
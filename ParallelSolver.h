@@ -0,0 +1,252 @@
+#pragma once
+
+#include "Pickup.h"
+#include "PlateKernel.h"
+#include "StringKernel.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class PlatePickups;
+
+/// Advances a single large string on several threads. The grid is split into
+/// one partition per thread, and each partition only ever reads the two
+/// points of its neighbours closest to it (the halo).
+///
+/// There is no barrier between time steps. Instead every partition counts the
+/// time steps it has completed, and starts a time step once both neighbours
+/// have completed the previous one. Partitions that share a halo are thus at
+/// most one time step apart, so the three rotating states are enough: no
+/// partition overwrites a state its neighbours may still read.
+class ParallelStringSolver
+{
+    public:
+    /// Create a solver and start its worker threads.
+    /// @param  numThreads  The number of threads, including the calling one.
+    /// @param  maxSteps    The largest number of time steps per run.
+    /// @param  maxChannels The most channels per frame of a run.
+    ParallelStringSolver(int numThreads, int maxSteps = 64, int maxChannels = 2);
+
+    ParallelStringSolver(const ParallelStringSolver &) = delete;
+    ParallelStringSolver &operator=(const ParallelStringSolver &) = delete;
+
+    /// Stop the worker threads.
+    ~ParallelStringSolver();
+
+    /// Get the forces of a time step of the next run, which must be known
+    /// before it starts.
+    /// @param  step    The time step.
+    SparseForces &getForces(int step) { return forces[step]; };
+
+    /// Get the most channels per frame of a run.
+    int getMaxChannels() const { return maxChannels; };
+
+    /// Get the largest number of time steps per run.
+    int getMaxSteps() const { return maxSteps; };
+
+    /// Get the number of threads, including the calling one.
+    int getNumThreads() const { return numThreads; };
+
+    /// Check whether a string is large enough for every thread to get enough
+    /// work to outweigh the synchronization.
+    /// @param  n   The number of points in the string.
+    bool isWorthwhile(int n) const { return n >= minPointsPerThread * numThreads; };
+
+    /// Advance the string several time steps and clear the forces. Blocks
+    /// until all partitions are done. The output of each partition is sized
+    /// up front, so a run with more channels than that is rejected.
+    /// @param  c               The folded coefficients.
+    /// @param  states          The previous, current and next state. After
+    ///                         `numSteps` time steps the latest state is in
+    ///                         `states[(numSteps + 1) % 3]`.
+    /// @param  n               The number of points.
+    /// @param  numSteps        The number of time steps, at most `getMaxSteps()`.
+    /// @param  pickups         The pickups to read after each time step.
+    /// @param  k               The sample period.
+    /// @param  out             Where to write the interleaved output.
+    /// @param  numChannels     The number of channels per frame, at most
+    ///                         `getMaxChannels()`.
+    /// @param  energy          If not null, set to the energy between the
+    ///                         previous and current state of the last time
+    ///                         step.
+    /// @returns                False if there are too many channels, in which
+    ///                         case nothing is done.
+    bool run(
+        const StringCoefficients<float> &c,
+        float *const *states,
+        int n,
+        int numSteps,
+        const Pickups &pickups,
+        float k,
+        float *out,
+        int numChannels,
+        float *energy = nullptr);
+
+    private:
+    /// Advance one partition all time steps of the current run.
+    /// @param  p   The index of the partition.
+    void runPartition(int p);
+
+    /// Wait for and run the partition of a worker thread until stopped.
+    /// @param  p   The index of the partition.
+    void work(int p);
+
+    // Keep each counter on its own cache line, such that a partition
+    // publishing its progress does not stall its neighbours.
+    struct alignas(64) Progress
+    {
+        std::atomic<int> steps;
+        float energy;       // The energy of the partition in the last step.
+    };
+
+    static constexpr int minPointsPerThread = 1024;
+
+    int numThreads = 1;
+    int maxSteps = 64;
+    int maxChannels = 2;
+    std::vector<SparseForces> forces;
+    std::vector<Progress> progress;
+    std::vector<std::vector<float>> outputs;    // The output of each partition.
+    std::vector<std::thread> workers;
+
+    // The current run.
+    const StringCoefficients<float> *coeffs = nullptr;
+    float *states[3] = {nullptr, nullptr, nullptr};
+    int n = 0;
+    int numSteps = 0;
+    const Pickups *pickups = nullptr;
+    float k = 0;
+    int numChannels = 0;
+    bool measureEnergy = false;
+
+    // Starting and finishing runs.
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    int generation = 0;     // The number of runs started.
+    int running = 0;        // The number of workers still in the current run.
+    bool stopping = false;
+};
+
+/// Advances a single large plate on several threads, split into one band of
+/// rows per thread. Like the partitions of `ParallelStringSolver`, each band
+/// only reads the two rows of its neighbours closest to it, so the bands are
+/// synchronized the same way: a band starts a time step once both neighbours
+/// have completed the previous one, without a barrier.
+class ParallelPlateSolver
+{
+    public:
+    /// Create a solver and start its worker threads.
+    /// @param  numThreads  The number of threads, including the calling one.
+    /// @param  maxSteps    The largest number of time steps per run.
+    /// @param  maxChannels The most channels per frame of a run.
+    ParallelPlateSolver(int numThreads, int maxSteps = 64, int maxChannels = 2);
+
+    ParallelPlateSolver(const ParallelPlateSolver &) = delete;
+    ParallelPlateSolver &operator=(const ParallelPlateSolver &) = delete;
+
+    /// Stop the worker threads.
+    ~ParallelPlateSolver();
+
+    /// Get the forces of a time step of the next run, which must be known
+    /// before it starts.
+    /// @param  step    The time step.
+    SparseForces &getForces(int step) { return forces[step]; };
+
+    /// Get the most channels per frame of a run.
+    int getMaxChannels() const { return maxChannels; };
+
+    /// Get the largest number of time steps per run.
+    int getMaxSteps() const { return maxSteps; };
+
+    /// Get the number of threads, including the calling one.
+    int getNumThreads() const { return numThreads; };
+
+    /// Check whether a plate is large enough for every thread to get enough
+    /// work to outweigh the synchronization.
+    /// @param  nx  The number of points per row.
+    /// @param  ny  The number of rows.
+    bool isWorthwhile(int nx, int ny) const
+    {
+        return ny >= minRowsPerThread * numThreads && nx * ny >= minPointsPerThread * numThreads;
+    };
+
+    /// Advance the plate several time steps and clear the forces. Blocks
+    /// until all bands are done. The output of each band is sized up front,
+    /// so a run with more channels than that is rejected.
+    /// @param  c               The folded coefficients.
+    /// @param  states          The previous, current and next state. After
+    ///                         `numSteps` time steps the latest state is in
+    ///                         `states[(numSteps + 1) % 3]`.
+    /// @param  stride          The distance between rows.
+    /// @param  nx              The number of points per row.
+    /// @param  ny              The number of rows.
+    /// @param  tileWidth       The number of columns per tile.
+    /// @param  numSteps        The number of time steps, at most `getMaxSteps()`.
+    /// @param  pickups         The pickups to read after each time step.
+    /// @param  k               The sample period.
+    /// @param  out             Where to write the interleaved output.
+    /// @param  numChannels     The number of channels per frame, at most
+    ///                         `getMaxChannels()`.
+    /// @returns                False if there are too many channels, in which
+    ///                         case nothing is done.
+    bool run(
+        const PlateCoefficients<float> &c,
+        float *const *states,
+        int stride,
+        int nx,
+        int ny,
+        int tileWidth,
+        int numSteps,
+        const PlatePickups &pickups,
+        float k,
+        float *out,
+        int numChannels);
+
+    private:
+    /// Advance one band all time steps of the current run.
+    /// @param  p   The index of the band.
+    void runBand(int p);
+
+    /// Wait for and run the band of a worker thread until stopped.
+    /// @param  p   The index of the band.
+    void work(int p);
+
+    struct alignas(64) Progress
+    {
+        std::atomic<int> steps;
+    };
+
+    static constexpr int minRowsPerThread = 8;
+    static constexpr int minPointsPerThread = 2048;
+
+    int numThreads = 1;
+    int maxSteps = 64;
+    int maxChannels = 2;
+    std::vector<SparseForces> forces;
+    std::vector<Progress> progress;
+    std::vector<std::vector<float>> outputs;    // The output of each band.
+    std::vector<std::thread> workers;
+
+    // The current run.
+    const PlateCoefficients<float> *coeffs = nullptr;
+    float *states[3] = {nullptr, nullptr, nullptr};
+    int stride = 0;
+    int nx = 0;
+    int ny = 0;
+    int tileWidth = 0;
+    int numSteps = 0;
+    const PlatePickups *pickups = nullptr;
+    float k = 0;
+    int numChannels = 0;
+
+    // Starting and finishing runs.
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    int generation = 0;     // The number of runs started.
+    int running = 0;        // The number of workers still in the current run.
+    bool stopping = false;
+};
@@ -0,0 +1,68 @@
+#include "Pickup.h"
+
+#ifdef PAL
+#include "pal/Gui.h"
+#endif
+
+Pickups::Pickups(int n) : n(n)
+{
+}
+
+int Pickups::add(float position, float gain, float pan, PickupOutput output, Interpolation type)
+{
+    Pickup pickup;
+    pickup.point.setPosition(position, n, type);
+    pickup.output = output;
+    pickup.gain = gain;
+    pickup.pan = pan;
+    pickups.push_back(pickup);
+    return pickups.size() - 1;
+}
+
+void Pickups::draw()
+{
+#ifdef PAL
+    const char *outputs[] = {"Displacement", "Velocity", "Bridge force"};
+
+    for (int i = 0; i < pickups.size(); i++)
+    {
+        Pickup &pickup = pickups[i];
+        float position = pickup.point.getPosition();
+
+        ImGui::PushID(i);
+
+        if (ImGui::SliderFloat("Pickup position", &position, 0, 1))
+        {
+            pickup.point.setPosition(position);
+        }
+
+        ImGui::SliderFloat("Pickup pan", &pickup.pan, -1, 1);
+        ImGui::Combo("Pickup output", (int *)&pickup.output, outputs, IM_ARRAYSIZE(outputs));
+        ImGui::PopID();
+    }
+#endif
+}
+
+void Pickups::remove(int i)
+{
+    pickups.erase(pickups.begin() + i);
+}
+
+void Pickups::setBridge(const StringParameters &params, float h, BoundaryCondition bc)
+{
+    // The force on the bridge is gamma0 u_x - kappa0 u_xxx at x = 0, where
+    // u[-1] = 0 and the ghost point u[-2] mirrors u[0].
+    float ghost = bc == BoundaryCondition::Clamped ? 1 : -1;
+    float h3 = h * h * h;
+
+    bridge0 = params.gamma0 / h + params.kappa0 * (3 + ghost) / h3;
+    bridge1 = -params.kappa0 / h3;
+}
+
+void Pickups::setGridSize(int value)
+{
+    n = value;
+
+    for (auto &pickup : pickups)
+        pickup.point.setGridSize(n);
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "Excitation.h"
+#include "StringModel.h"
+#include <algorithm>
+#include <vector>
+
+/// The quantity a pickup measures.
+enum class PickupOutput
+{
+    Displacement,   // The displacement at the pickup.
+    Velocity,       // The velocity at the pickup.
+    BridgeForce     // The force the string exerts on the bridge at x = 0.
+};
+
+/// A pickup reading the string at a fractional position.
+struct Pickup
+{
+    ExcitationPoint point;
+    PickupOutput output = PickupOutput::Displacement;
+    float gain = 1;
+    float pan = 0;      // From -1 (left) to 1 (right).
+    int channel = -1;   // A dedicated output channel, or -1 to pan between
+                        // the first two channels.
+    float displacement = 0; // The displacement integrated from the velocity,
+                            // by models that only know the latter.
+};
+
+/// The set of pickups of a string. Together they turn one time step of the
+/// string into one frame of mono, stereo or multichannel output.
+class Pickups
+{
+    public:
+    /// Create an empty set of pickups.
+    /// @param  n   The number of points in the string.
+    Pickups(int n);
+
+    /// Add the contributions of the points in a range to one frame of output.
+    /// Accumulating all ranges that make up the string gives the same frame as
+    /// `read`.
+    /// @param  u               The current state.
+    /// @param  up              The previous state.
+    /// @param  k               The sample period.
+    /// @param  lo              The first point of the range.
+    /// @param  hi              One past the last point of the range.
+    /// @param  frame           The frame to add to.
+    /// @param  numChannels     The number of channels in the frame.
+    template <typename State>
+    void accumulate(
+        const State &u,
+        const State &up,
+        float k,
+        int lo,
+        int hi,
+        float *frame,
+        int numChannels) const;
+
+    /// Add a pickup.
+    /// @param  position    The position as a fraction of the string length.
+    /// @param  gain        The gain of the pickup.
+    /// @param  pan         The stereo position from -1 (left) to 1 (right).
+    /// @param  output      The quantity to measure.
+    /// @param  type        The interpolation to use.
+    /// @returns            The index of the new pickup.
+    int add(
+        float position,
+        float gain = 1,
+        float pan = 0,
+        PickupOutput output = PickupOutput::Displacement,
+        Interpolation type = Interpolation::Linear);
+
+    /// Draw a UI for controlling the pickups.
+    void draw();
+
+    /// Add the measured value of a pickup to a frame, on its own channel or
+    /// panned between the first two.
+    /// @param  pickup          The pickup.
+    /// @param  y               The measured value, before the gain.
+    /// @param  frame           The frame to add to.
+    /// @param  numChannels     The number of channels in the frame.
+    static void mix(const Pickup &pickup, float y, float *frame, int numChannels);
+
+    /// Get a pickup.
+    /// @param  i   The index of the pickup.
+    Pickup &get(int i) { return pickups[i]; };
+
+    /// Read all pickups and write one frame of output.
+    /// @param  u               The current state.
+    /// @param  up              The previous state.
+    /// @param  k               The sample period.
+    /// @param  frame           Where to write the frame.
+    /// @param  numChannels     The number of channels in the frame.
+    template <typename State>
+    void read(const State &u, const State &up, float k, float *frame, int numChannels) const;
+
+    /// Read all pickups and mix them to mono.
+    /// @param  u   The current state.
+    /// @param  up  The previous state.
+    /// @param  k   The sample period.
+    /// @returns    The sum of all pickups.
+    template <typename State>
+    float readMono(const State &u, const State &up, float k) const;
+
+    /// Remove a pickup.
+    /// @param  i   The index of the pickup.
+    void remove(int i);
+
+    /// Set the string parameters, which determine the bridge force.
+    /// @param  params  The string parameters.
+    /// @param  h       The grid spacing.
+    /// @param  bc      The boundary condition at both ends.
+    void setBridge(const StringParameters &params, float h, BoundaryCondition bc);
+
+    /// Set the number of points in the string, moving all pickups to the new
+    /// grid.
+    /// @param  value   The number of points.
+    void setGridSize(int value);
+
+    /// Get the number of pickups.
+    int size() const { return pickups.size(); };
+
+    private:
+    /// Measure the part of the output of a single pickup that comes from the
+    /// points in a range.
+    template <typename State>
+    float measure(const Pickup &pickup, const State &u, const State &up, float k, int lo, int hi) const;
+
+    std::vector<Pickup> pickups;
+    int n = 0;
+
+    // The bridge force is a weighted sum of the two outermost points.
+    float bridge0 = 0;
+    float bridge1 = 0;
+};
+
+template <typename State>
+inline float Pickups::measure(const Pickup &pickup, const State &u, const State &up, float k, int lo, int hi) const
+{
+    if (pickup.output == PickupOutput::BridgeForce)
+    {
+        return (lo <= 0 && 0 < hi ? bridge0 * u[0] : 0)
+            + (lo <= 1 && 1 < hi ? bridge1 * u[1] : 0);
+    }
+
+    const ExcitationPoint &point = pickup.point;
+    int first = point.index > lo ? point.index : lo;
+    int last = point.index + point.taps < hi ? point.index + point.taps : hi;
+    float y = 0;
+
+    for (int i = first; i < last; i++)
+    {
+        float w = point.weights[i - point.index];
+        y += pickup.output == PickupOutput::Velocity ? w * (u[i] - up[i]) : w * u[i];
+    }
+
+    return pickup.output == PickupOutput::Velocity ? (1 / k) * y : y;
+}
+
+inline void Pickups::mix(const Pickup &pickup, float y, float *frame, int numChannels)
+{
+    y *= pickup.gain;
+
+    if (pickup.channel >= 0)
+    {
+        if (pickup.channel < numChannels)
+            frame[pickup.channel] += y;
+    }
+    else if (numChannels == 1)
+    {
+        frame[0] += y;
+    }
+    else
+    {
+        // Balance panning, such that a centered pickup is at full level in
+        // both channels.
+        frame[0] += std::min(1.0f, 1 - pickup.pan) * y;
+        frame[1] += std::min(1.0f, 1 + pickup.pan) * y;
+    }
+}
+
+template <typename State>
+void Pickups::accumulate(
+    const State &u,
+    const State &up,
+    float k,
+    int lo,
+    int hi,
+    float *frame,
+    int numChannels) const
+{
+    for (const auto &pickup : pickups)
+        mix(pickup, measure(pickup, u, up, k, lo, hi), frame, numChannels);
+}
+
+template <typename State>
+void Pickups::read(const State &u, const State &up, float k, float *frame, int numChannels) const
+{
+    for (int channel = 0; channel < numChannels; channel++)
+        frame[channel] = 0;
+
+    accumulate(u, up, k, 0, n, frame, numChannels);
+}
+
+template <typename State>
+float Pickups::readMono(const State &u, const State &up, float k) const
+{
+    float y = 0;
+    accumulate(u, up, k, 0, n, &y, 1);
+    return y;
+}
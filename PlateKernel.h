@@ -0,0 +1,212 @@
+#pragma once
+
+#include "StringKernel.h"
+#include "StringModel.h"
+
+/// The coefficients of the folded update of a stiff plate, the 2D analogue of
+/// `StringCoefficients`. The next state of a point is a weighted sum of the
+/// 13 points within two steps of it in the current state and the 5 points
+/// within one step of it in the previous state.
+template <typename Real>
+struct PlateCoefficients
+{
+    Real a0 = 0;    // Weight of u[x, y].
+    Real a1 = 0;    // Weight of the 4 neighbours one step away.
+    Real ad = 0;    // Weight of the 4 diagonal neighbours.
+    Real a2 = 0;    // Weight of the 4 points two steps away.
+    Real b0 = 0;    // Weight of up[x, y].
+    Real b1 = 0;    // Weight of the 4 neighbours in the previous state.
+    Real bf = 0;    // Weight of the force density f[x, y].
+    Real ghost = 0; // The ghost point beyond an edge as a multiple of the
+                    // mirrored point.
+
+    /// Fold the parameters into coefficients, for a plate with the same
+    /// equation as a stiff string, with the Laplacian in place of the second
+    /// derivative.
+    /// @param  p   The plate parameters.
+    /// @param  k   The sample period.
+    /// @param  h   The grid spacing.
+    /// @param  bc  The boundary condition at all edges.
+    void compute(const StringParameters &p, double k, double h, BoundaryCondition bc)
+    {
+        double c1 = 1 / (1 + p.sigma0 * k);
+        double k2 = k * k;
+        double h2 = h * h;
+        double lambda2 = k2 * p.gamma0 / h2;
+        double mu2 = k2 * p.kappa0 / (h2 * h2);
+        double s = 2 * p.sigma1 * k / h2;
+
+        // The biharmonic stencil is 20 at the center, -8 one step away, 2 on
+        // the diagonals and 1 two steps away.
+        a0 = c1 * (2 - 4 * lambda2 - 20 * mu2 - 4 * s);
+        a1 = c1 * (lambda2 + 8 * mu2 + s);
+        ad = c1 * -2 * mu2;
+        a2 = c1 * -mu2;
+        b0 = c1 * (p.sigma0 * k - 1 + 4 * s);
+        b1 = c1 * -s;
+        bf = c1 * k2;
+
+        ghost = bc == BoundaryCondition::Clamped ? 1 : -1;
+    }
+};
+
+// The plate state is stored row by row, with two rows and columns of padding
+// around the nx by ny inner points, and rows padded to `stride` values. The
+// inner rows and columns of padding are the fixed edges and always zero. The
+// outer ones hold the ghost points, which mirror the points next to the
+// edges and are rewritten after every time step. With the edges in the
+// padding, every inner point is updated by the same 13-point stencil.
+
+/// Compute the update of a single inner point without any applied force.
+/// @param  c       The folded coefficients.
+/// @param  u       The current state.
+/// @param  up      The previous state.
+/// @param  i       The index of the point in the padded state.
+/// @param  stride  The distance between rows.
+/// @returns        The value of the point at the next time step.
+template <typename Real, typename State>
+inline Real stiffPlatePoint(const PlateCoefficients<Real> &c, const State &u, const State &up, int i, int stride)
+{
+    int s = stride;
+
+    return c.a0 * u[i]
+        + c.a1 * (u[i-1] + u[i+1] + u[i-s] + u[i+s])
+        + c.ad * (u[i-s-1] + u[i-s+1] + u[i+s-1] + u[i+s+1])
+        + c.a2 * (u[i-2] + u[i+2] + u[i-2*s] + u[i+2*s])
+        + c.b0 * up[i]
+        + c.b1 * (up[i-1] + up[i+1] + up[i-s] + up[i+s]);
+}
+
+/// Compute a run of points of one row. The loop only reads fixed offsets of
+/// the row pointers, such that it vectorizes.
+/// @param  c       The folded coefficients.
+/// @param  u       The current state at the first point.
+/// @param  up      The previous state at the first point.
+/// @param  un      The next state at the first point.
+/// @param  stride  The distance between rows.
+/// @param  count   The number of points.
+template <typename Real>
+inline void stiffPlateRun(
+    const PlateCoefficients<Real> &c,
+    const Real *u,
+    const Real *up,
+    Real *un,
+    int stride,
+    int count)
+{
+    const Real *n1 = u - stride;
+    const Real *n2 = u - 2 * stride;
+    const Real *s1 = u + stride;
+    const Real *s2 = u + 2 * stride;
+    const Real *pn = up - stride;
+    const Real *ps = up + stride;
+
+    for (int x = 0; x < count; x++)
+    {
+        un[x] = c.a0 * u[x]
+            + c.a1 * ((u[x-1] + u[x+1]) + (n1[x] + s1[x]))
+            + c.ad * ((n1[x-1] + n1[x+1]) + (s1[x-1] + s1[x+1]))
+            + c.a2 * ((u[x-2] + u[x+2]) + (n2[x] + s2[x]))
+            + c.b0 * up[x]
+            + c.b1 * ((up[x-1] + up[x+1]) + (pn[x] + ps[x]));
+    }
+}
+
+/// Compute a band of rows of the next state, without any applied force.
+///
+/// Wide rows are split into tiles of columns, and each tile is swept from the
+/// first to the last row of the band, such that the five rows of the current
+/// state a row reads stay in the L1 cache while the next row reuses four of
+/// them.
+///
+/// @param  c           The folded coefficients.
+/// @param  u           The current state.
+/// @param  up          The previous state.
+/// @param  un          The next state.
+/// @param  stride      The distance between rows.
+/// @param  nx          The number of inner points per row.
+/// @param  y0          The first inner row of the band.
+/// @param  y1          One past the last inner row of the band.
+/// @param  tileWidth   The number of columns per tile.
+template <typename Real>
+inline void stiffPlateRows(
+    const PlateCoefficients<Real> &c,
+    const Real *u,
+    const Real *up,
+    Real *un,
+    int stride,
+    int nx,
+    int y0,
+    int y1,
+    int tileWidth)
+{
+    for (int x0 = 0; x0 < nx; x0 += tileWidth)
+    {
+        int count = std::min(tileWidth, nx - x0);
+
+        for (int y = y0; y < y1; y++)
+        {
+            int i = (y + 2) * stride + 2 + x0;
+            stiffPlateRun(c, u + i, up + i, un + i, stride, count);
+        }
+    }
+}
+
+/// Write the ghost points of a band of rows from the points next to the
+/// edges, which must be done after the forces are applied to the band.
+/// @param  c       The folded coefficients.
+/// @param  un      The state.
+/// @param  stride  The distance between rows.
+/// @param  nx      The number of inner points per row.
+/// @param  ny      The number of inner rows.
+/// @param  y0      The first inner row of the band.
+/// @param  y1      One past the last inner row of the band.
+template <typename Real>
+inline void stiffPlateGhosts(const PlateCoefficients<Real> &c, Real *un, int stride, int nx, int ny, int y0, int y1)
+{
+    for (int y = y0; y < y1; y++)
+    {
+        Real *row = un + (y + 2) * stride + 2;
+        row[-2] = c.ghost * row[0];
+        row[nx+1] = c.ghost * row[nx-1];
+    }
+
+    if (y0 == 0)
+    {
+        for (int x = 0; x < nx; x++)
+            un[2 + x] = c.ghost * un[2 * stride + 2 + x];
+    }
+
+    if (y1 == ny)
+    {
+        for (int x = 0; x < nx; x++)
+            un[(ny + 3) * stride + 2 + x] = c.ghost * un[(ny + 1) * stride + 2 + x];
+    }
+}
+
+/// Advance a whole plate one time step.
+/// @param  c           The folded coefficients.
+/// @param  u           The current state.
+/// @param  up          The previous state.
+/// @param  forces      The forces applied during the time step.
+/// @param  un          The next state.
+/// @param  stride      The distance between rows.
+/// @param  nx          The number of inner points per row.
+/// @param  ny          The number of inner rows.
+/// @param  tileWidth   The number of columns per tile.
+template <typename Real>
+inline void stiffPlateStep(
+    const PlateCoefficients<Real> &c,
+    const Real *u,
+    const Real *up,
+    const SparseForces &forces,
+    Real *un,
+    int stride,
+    int nx,
+    int ny,
+    int tileWidth)
+{
+    stiffPlateRows(c, u, up, un, stride, nx, 0, ny, tileWidth);
+    forces.apply(un, c.bf);
+    stiffPlateGhosts(c, un, stride, nx, ny, 0, ny);
+}
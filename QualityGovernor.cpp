@@ -0,0 +1,86 @@
+#include "QualityGovernor.h"
+#include <algorithm>
+
+#ifdef PAL
+#include "pal/Gui.h"
+#endif
+
+QualityGovernor::QualityGovernor(int maxLevel, float sampleRate) :
+    maxLevel(std::max(0, maxLevel)),
+    sampleRate(sampleRate)
+{
+}
+
+void QualityGovernor::draw()
+{
+#ifdef PAL
+    ImGui::Text("Callback load: %.0f%%, peak %.0f%%", 100 * load, 100 * peakLoad);
+    ImGui::Text("Quality level: %i of %i", level, maxLevel);
+    ImGui::SliderFloat("Step down load", &highLoad, 0, 1);
+    ImGui::SliderFloat("Step up load", &lowLoad, 0, 1);
+
+    for (int i = std::max(0, numChanges - logSize); i < numChanges; i++)
+    {
+        const QualityChange &change = getChange(i);
+        ImGui::Text("%.1f s: level %i at %.0f%% load", change.time, change.level, 100 * change.load);
+    }
+#endif
+}
+
+bool QualityGovernor::finishCallback(int numFrames)
+{
+    auto stop = std::chrono::steady_clock::now();
+    return update(std::chrono::duration<double>(stop - start).count(), numFrames);
+}
+
+void QualityGovernor::setLevel(int value)
+{
+    level = value;
+    lastChange = time;
+    calm = 0;
+
+    QualityChange &change = log[numChanges % logSize];
+    change.time = time;
+    change.level = level;
+    change.load = load;
+    numChanges++;
+}
+
+bool QualityGovernor::update(double seconds, int numFrames)
+{
+    if (numFrames <= 0)
+        return false;
+
+    double period = numFrames / sampleRate;
+    load = seconds / period;
+    peakLoad = std::max(peakLoad, load);
+    time += period;
+
+    if (load > highLoad)
+    {
+        calm = 0;
+
+        // Give the last step down a chance to take effect first.
+        if (level < maxLevel && time - lastChange >= settleTime)
+        {
+            setLevel(level + 1);
+            return true;
+        }
+    }
+    else if (load < lowLoad)
+    {
+        calm += period;
+
+        if (level > 0 && calm >= holdTime)
+        {
+            setLevel(level - 1);
+            return true;
+        }
+    }
+    else
+    {
+        calm = 0;
+    }
+
+    return false;
+}
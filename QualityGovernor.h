@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+
+/// A change of quality level made by a `QualityGovernor`.
+struct QualityChange
+{
+    double time = 0;    // When the change was made, in seconds of audio.
+    int level = 0;      // The new level.
+    float load = 0;     // The load of the callback that caused it.
+};
+
+/// Watches how long each audio callback takes against the period of its
+/// buffer, and chooses a quality level such that the callbacks keep clear of
+/// their deadline. A single callback over the high load steps the quality
+/// down at once, while stepping back up needs the load to stay under the low
+/// load for a while, such that the level does not oscillate.
+class QualityGovernor
+{
+    public:
+    /// Create a governor at full quality.
+    /// @param  maxLevel    The lowest quality level.
+    /// @param  sampleRate  The sample rate of the callbacks.
+    QualityGovernor(int maxLevel, float sampleRate = 44100);
+
+    /// Draw a UI showing the load and the recent changes of level.
+    void draw();
+
+    /// Finish timing a callback and choose the quality level.
+    /// @param  numFrames   The number of frames the callback computed.
+    /// @returns            True if the quality level changed.
+    bool finishCallback(int numFrames);
+
+    /// Get a recent change of level.
+    /// @param  i   The index of the change, counting all changes ever made,
+    ///             which must be one of the last `logSize`.
+    const QualityChange &getChange(int i) const { return log[i % logSize]; };
+
+    /// Get the quality level, from 0 (full quality) to the lowest level.
+    int getLevel() const { return level; };
+
+    /// Get the load of the last callback, its duration relative to the period
+    /// of its buffer.
+    float getLoad() const { return load; };
+
+    /// Get the number of changes of level ever made.
+    int getNumChanges() const { return numChanges; };
+
+    /// Get the highest load since the telemetry was last reset.
+    float getPeakLoad() const { return peakLoad; };
+
+    /// Reset the peak load.
+    void resetTelemetry() { peakLoad = 0; };
+
+    /// Start timing a callback.
+    void startCallback() { start = std::chrono::steady_clock::now(); };
+
+    /// Choose the quality level from the duration of a callback.
+    /// @param  seconds     How long the callback took.
+    /// @param  numFrames   The number of frames the callback computed.
+    /// @returns            True if the quality level changed.
+    bool update(double seconds, int numFrames);
+
+    float highLoad = 0.75;      // The load that steps the quality down.
+    float lowLoad = 0.4;        // The load under which it may step up.
+    float holdTime = 2;         // How long the load must stay low to step up.
+    float settleTime = 0.05;    // How long to wait for a step down to take
+                                // effect before stepping down again.
+
+    static constexpr int logSize = 8;
+
+    private:
+    /// Change the level and log the change.
+    void setLevel(int value);
+
+    int maxLevel = 0;
+    float sampleRate = 44100;
+    int level = 0;
+
+    float load = 0;
+    float peakLoad = 0;
+    double time = 0;            // Seconds of audio computed.
+    double lastChange = -1e9;   // When the level last changed.
+    double calm = 0;            // Seconds the load has been low.
+
+    QualityChange log[logSize];
+    int numChanges = 0;
+
+    std::chrono::steady_clock::time_point start;
+};
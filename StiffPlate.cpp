@@ -0,0 +1,251 @@
+#include "StiffPlate.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef PAL
+#include "pal/Gui.h"
+#endif
+
+int computeStablePlateSize(const StringParameters &params, float sampleRate)
+{
+    return floor(computeStableSize(params, sampleRate) / M_SQRT2);
+}
+
+void PlatePoint::setPosition(float x, float y, int nx, int ny, int stride)
+{
+    this->x = x;
+    this->y = y;
+    this->stride = stride;
+
+    // Keep all four touched points on the inner grid.
+    float gx = std::min<float>(std::max<float>(x * (nx - 1), 0), nx - 1.001f);
+    float gy = std::min<float>(std::max<float>(y * (ny - 1), 0), ny - 1.001f);
+    int ix = floor(gx);
+    int iy = floor(gy);
+    float tx = gx - ix;
+    float ty = gy - iy;
+
+    index = (iy + 2) * stride + ix + 2;
+    weights[0] = (1 - tx) * (1 - ty);
+    weights[1] = tx * (1 - ty);
+    weights[2] = (1 - tx) * ty;
+    weights[3] = tx * ty;
+
+    norm = 0;
+
+    for (int j = 0; j < 4; j++)
+        norm += weights[j] * weights[j];
+}
+
+void PlatePickups::accumulate(const float *u, const float *up, float k, int lo, int hi, float *frame, int numChannels) const
+{
+    for (const auto &pickup : pickups)
+    {
+        const PlatePoint &point = pickup.point;
+        float y = 0;
+
+        for (int j = 0; j < 4; j++)
+        {
+            int i = point.index + point.offset(j);
+
+            if (i < lo || i >= hi)
+                continue;
+
+            float w = point.weights[j];
+            y += pickup.output == PickupOutput::Velocity ? w * (u[i] - up[i]) : w * u[i];
+        }
+
+        if (pickup.output == PickupOutput::Velocity)
+            y *= 1 / k;
+        else if (pickup.output == PickupOutput::BridgeForce)
+            y = 0;
+
+        y *= pickup.gain;
+
+        if (pickup.channel >= 0)
+        {
+            if (pickup.channel < numChannels)
+                frame[pickup.channel] += y;
+        }
+        else if (numChannels == 1)
+        {
+            frame[0] += y;
+        }
+        else
+        {
+            frame[0] += fminf(1, 1 - pickup.pan) * y;
+            frame[1] += fminf(1, 1 + pickup.pan) * y;
+        }
+    }
+}
+
+int PlatePickups::add(const PlatePickup &pickup)
+{
+    pickups.push_back(pickup);
+    return pickups.size() - 1;
+}
+
+void PlatePickups::remove(int i)
+{
+    pickups.erase(pickups.begin() + i);
+}
+
+StiffPlate::StiffPlate(int nx, int ny, float sampleRate, BoundaryCondition bc) :
+    boundary(bc),
+    nx(std::max(nx, 2)),
+    ny(std::max(ny, 2)),
+    sampleRate(sampleRate)
+{
+    // Pad the rows with two points at either side, and to a multiple of 16
+    // values, such that every row starts at the same alignment.
+    stride = (this->nx + 4 + 15) / 16 * 16;
+    k = 1.0f / sampleRate;
+    h = 1.0f / this->nx;
+
+    up.resize(stride * (this->ny + 4), 0);
+    u.resize(stride * (this->ny + 4), 0);
+    un.resize(stride * (this->ny + 4), 0);
+
+    bow.point.setPosition(0.3, 0.4, this->nx, this->ny, stride);
+    bow.friction.setSampleRate(sampleRate);
+    strikes.reserve(8);
+
+    setParameters(params);
+}
+
+int StiffPlate::addPickup(float x, float y, float gain, float pan, PickupOutput output)
+{
+    PlatePickup pickup;
+    pickup.point.setPosition(x, y, nx, ny, stride);
+    pickup.gain = gain;
+    pickup.pan = pan;
+    pickup.output = output;
+    return pickups.add(pickup);
+}
+
+void StiffPlate::computeForces(SparseForces &f, bool bowed)
+{
+    for (auto &strike : strikes)
+    {
+        if (strike.isActive())
+            strike.point.spread(f, (1 / (h * h)) * strike.next());
+    }
+
+    if (!bowed || bow.fb == 0)
+        return;
+
+    // Solve the bow like `Bow::computeForce`, with the plate update at the
+    // bow in place of the string update.
+    float y = bow.point.read(u);
+    float yp = bow.point.read(up);
+    float L = bow.point.predict(coeffs, u, up, f);
+    float g = (coeffs.bf / (h * h)) * bow.point.norm;
+    float c0 = (1 / (2 * k)) * (L - yp) - bow.vb;
+    float c1 = (1 / (2 * k)) * g * bow.fb;
+    float guess = (1 / k) * (y - yp) - bow.vb;
+
+    bow.friction.setModel(bow.model);
+    bow.friction.setCharacteristic(bow.a);
+    float force = -bow.fb * bow.friction.solve(c0, c1, guess);
+    bow.point.spread(f, (1 / (h * h)) * force);
+}
+
+void StiffPlate::draw()
+{
+#ifdef PAL
+    const char *frictionModels[] = {"Exponential", "Tabulated", "Hyperbolic", "Thermal"};
+
+    ImGui::SliderFloat("Bowing force", &bow.fb, 0, 100);
+    ImGui::Combo("Friction model", (int *)&bow.model, frictionModels, IM_ARRAYSIZE(frictionModels));
+    ImGui::Text("Plate: %i x %i points, %s", nx, ny, solver ? "threaded" : "single thread");
+#endif
+}
+
+void StiffPlate::process(float *out, int numFrames, int numChannels)
+{
+    int frame = 0;
+
+    if (solver && solver->isWorthwhile(nx, ny) && bow.fb == 0 && numChannels <= solver->getMaxChannels())
+    {
+        for (; frame < numFrames; frame += solver->getMaxSteps())
+        {
+            int numSteps = std::min(solver->getMaxSteps(), numFrames - frame);
+
+            for (int i = 0; i < numSteps; i++)
+                computeForces(solver->getForces(i), false);
+
+            float *states[3] = {up.data(), u.data(), un.data()};
+            solver->run(coeffs, states, stride, nx, ny, tileWidth, numSteps, pickups, k,
+                out + frame * numChannels, numChannels);
+
+            // Rotate the states, such that the latest one is current.
+            for (int i = 0; i < numSteps; i++)
+            {
+                std::swap(up, u);
+                std::swap(u, un);
+            }
+        }
+    }
+
+    for (; frame < numFrames; frame++)
+        step(out + frame * numChannels, numChannels);
+}
+
+void StiffPlate::reset()
+{
+    std::fill(up.begin(), up.end(), 0);
+    std::fill(u.begin(), u.end(), 0);
+    std::fill(un.begin(), un.end(), 0);
+
+    for (auto &strike : strikes)
+        strike.envelope = nullptr;
+
+    bow.friction.reset();
+}
+
+void StiffPlate::setNumThreads(int value, int maxChannels)
+{
+    if (value <= 1)
+        solver.reset();
+    else if (!solver || solver->getNumThreads() != value || solver->getMaxChannels() != maxChannels)
+        solver.reset(new ParallelPlateSolver(value, 64, maxChannels));
+}
+
+void StiffPlate::setParameters(const StringParameters &value)
+{
+    params = value;
+    coeffs.compute(params, k, h, boundary);
+}
+
+void StiffPlate::step(float *frame, int numChannels)
+{
+    computeForces(f, true);
+    stiffPlateStep(coeffs, u.data(), up.data(), f, un.data(), stride, nx, ny, tileWidth);
+    f.clear();
+
+    // Rotate the states, such that the next state becomes the current one.
+    std::swap(up, u);
+    std::swap(u, un);
+
+    for (int channel = 0; channel < numChannels; channel++)
+        frame[channel] = 0;
+
+    pickups.accumulate(u.data(), up.data(), k, 0, u.size(), frame, numChannels);
+}
+
+void StiffPlate::strike(float x, float y, float force, float duration)
+{
+    // Reuse a finished strike if there is one.
+    auto it = std::find_if(strikes.begin(), strikes.end(), [](const PlateStrike &s) { return !s.isActive(); });
+
+    if (it == strikes.end())
+    {
+        strikes.push_back(PlateStrike());
+        it = strikes.end() - 1;
+    }
+
+    it->point.setPosition(x, y, nx, ny, stride);
+    it->envelope = envelopes.getEnvelope(Envelope::Pulse, std::max(1, (int)(duration * sampleRate)));
+    it->force = force;
+    it->time = 0;
+}
@@ -0,0 +1,295 @@
+#pragma once
+
+#include "BowFriction.h"
+#include "Excitation.h"
+#include "ParallelSolver.h"
+#include "Pickup.h"
+#include "PlateKernel.h"
+#include "StringModel.h"
+#include <memory>
+#include <vector>
+
+/// Compute the largest number of points per row a square plate of unit width
+/// can have while the scheme is still stable for a set of parameters. The
+/// Laplacian of a plate reaches twice as far as the second derivative of a
+/// string, so the grid is sqrt(2) times coarser than that of a string.
+/// @param  params      The plate parameters.
+/// @param  sampleRate  The sample rate the plate runs at.
+/// @returns            The number of points per row.
+int computeStablePlateSize(const StringParameters &params, float sampleRate = 44100);
+
+/// A fractional position on a plate, which is read and excited through the
+/// four points around it with bilinear weights.
+class PlatePoint
+{
+    public:
+    /// Get the horizontal position as a fraction of the plate width.
+    float getX() const { return x; };
+
+    /// Get the vertical position as a fraction of the plate height.
+    float getY() const { return y; };
+
+    /// Get the offset of a touched point from the first one.
+    /// @param  j   The touched point, from 0 to 3.
+    int offset(int j) const { return (j >> 1) * stride + (j & 1); };
+
+    /// Predict the value at the position after the next time step, from the
+    /// forces applied so far.
+    /// @param  c   The folded coefficients of the plate.
+    /// @param  u   The current state.
+    /// @param  up  The previous state.
+    /// @param  f   The forces applied this time step.
+    template <typename Real, typename State>
+    float predict(const PlateCoefficients<Real> &c, const State &u, const State &up, const SparseForces &f) const
+    {
+        float y = 0;
+
+        for (int j = 0; j < 4; j++)
+        {
+            int i = index + offset(j);
+            y += weights[j] * (stiffPlatePoint(c, u, up, i, stride) + c.bf * f.at(i));
+        }
+
+        return y;
+    }
+
+    /// Read a state at the position.
+    /// @param  v   The state to read.
+    /// @returns    The interpolated value.
+    template <typename State>
+    float read(const State &v) const
+    {
+        float y = 0;
+
+        for (int j = 0; j < 4; j++)
+            y += weights[j] * v[index + offset(j)];
+
+        return y;
+    }
+
+    /// Set the position.
+    /// @param  x       The horizontal position as a fraction of the width.
+    /// @param  y       The vertical position as a fraction of the height.
+    /// @param  nx      The number of points per row.
+    /// @param  ny      The number of rows.
+    /// @param  stride  The distance between rows in the padded state.
+    void setPosition(float x, float y, int nx, int ny, int stride);
+
+    /// Spread a force density onto the plate.
+    /// @param  forces  The forces of the plate.
+    /// @param  force   The force density to spread.
+    void spread(SparseForces &forces, float force) const
+    {
+        for (int j = 0; j < 4; j++)
+            forces.add(index + offset(j), weights[j] * force);
+    }
+
+    int index = 0;          // The first point touched, in the padded state.
+    int stride = 0;         // The distance between rows.
+    float weights[4] = {0, 0, 0, 0};
+    float norm = 0;         // The sum of the squared weights.
+
+    private:
+    float x = 0;
+    float y = 0;
+};
+
+/// A pickup reading the plate at a fractional position. Only displacement
+/// and velocity can be measured, as a plate has no bridge.
+struct PlatePickup
+{
+    PlatePoint point;
+    PickupOutput output = PickupOutput::Displacement;
+    float gain = 1;
+    float pan = 0;      // From -1 (left) to 1 (right).
+    int channel = -1;   // A dedicated output channel, or -1 to pan between
+                        // the first two channels.
+};
+
+/// The set of pickups of a plate, turning one time step into one frame of
+/// output like `Pickups` does for a string.
+class PlatePickups
+{
+    public:
+    /// Add the contributions of the points in a range of the padded state to
+    /// one frame of output.
+    /// @param  u               The current state.
+    /// @param  up              The previous state.
+    /// @param  k               The sample period.
+    /// @param  lo              The first index of the range.
+    /// @param  hi              One past the last index of the range.
+    /// @param  frame           The frame to add to.
+    /// @param  numChannels     The number of channels in the frame.
+    void accumulate(const float *u, const float *up, float k, int lo, int hi, float *frame, int numChannels) const;
+
+    /// Add a pickup.
+    /// @param  pickup  The pickup.
+    /// @returns        The index of the new pickup.
+    int add(const PlatePickup &pickup);
+
+    /// Get a pickup.
+    /// @param  i   The index of the pickup.
+    PlatePickup &get(int i) { return pickups[i]; };
+
+    /// Remove a pickup.
+    /// @param  i   The index of the pickup.
+    void remove(int i);
+
+    /// Get the number of pickups.
+    int size() const { return pickups.size(); };
+
+    private:
+    std::vector<PlatePickup> pickups;
+};
+
+/// A bow on a plate, with the same parameters and friction as a `Bow`.
+struct PlateBow
+{
+    float vb = 0.2;     // Bow speed.
+    float a = 100;      // Friction characteristic.
+    float fb = 0;       // Bowing force.
+    FrictionModel model = FrictionModel::Tabulated;  // Friction law.
+
+    PlatePoint point;
+    BowFriction friction;
+};
+
+/// A strike on a plate, with a raised cosine force pulse.
+struct PlateStrike
+{
+    PlatePoint point;
+    std::shared_ptr<const std::vector<float>> envelope;
+    float force = 0;
+    int time = 0;
+
+    bool isActive() const { return envelope && time < envelope->size(); };
+
+    float next() { return force * (*envelope)[time++]; };
+};
+
+/// A stiff plate, or a membrane without stiffness, for gongs, cymbals and
+/// soundboards. It solves the equation of `StiffString` in two dimensions,
+/// with the same parameters, on a rectangular grid of unit width, fixed at
+/// all edges.
+///
+/// Each time step is a 13-point stencil over the whole grid. The state is
+/// padded such that the stencil is the same at every point, and the update
+/// is swept in tiles of columns that keep the rows it reads in cache. Large
+/// plates can be split into bands of rows, one per thread.
+class StiffPlate
+{
+    public:
+    /// Create a plate at rest.
+    /// @param  nx          The number of points per row.
+    /// @param  ny          The number of rows, which sets the height as
+    ///                     ny / nx times the width.
+    /// @param  sampleRate  The sample rate to use (default 44100).
+    /// @param  bc          The boundary condition at all edges.
+    StiffPlate(
+        int nx,
+        int ny,
+        float sampleRate = 44100,
+        BoundaryCondition bc = BoundaryCondition::SimplySupported);
+
+    /// Add a pickup.
+    /// @param  x       The horizontal position as a fraction of the width.
+    /// @param  y       The vertical position as a fraction of the height.
+    /// @param  gain    The gain of the pickup.
+    /// @param  pan     The stereo position from -1 (left) to 1 (right).
+    /// @param  output  The quantity to measure, displacement or velocity.
+    /// @returns        The index of the new pickup.
+    int addPickup(
+        float x,
+        float y,
+        float gain = 1,
+        float pan = 0,
+        PickupOutput output = PickupOutput::Displacement);
+
+    /// Draw a UI for controlling the plate.
+    void draw();
+
+    /// Get the bow, which is idle until given a force.
+    PlateBow &getBow() { return bow; };
+
+    /// Get the number of points per row.
+    int getNx() const { return nx; };
+
+    /// Get the number of rows.
+    int getNy() const { return ny; };
+
+    /// Get the parameters of the plate.
+    const StringParameters &getParameters() const { return params; };
+
+    /// Get the pickups.
+    PlatePickups &getPickups() { return pickups; };
+
+    /// Compute a block of output.
+    /// @param  out             Where to write the interleaved output.
+    /// @param  numFrames       The number of frames to compute.
+    /// @param  numChannels     The number of channels per frame.
+    void process(float *out, int numFrames, int numChannels);
+
+    /// Bring the plate to rest and stop all strikes.
+    void reset();
+
+    /// Set the number of threads `process` advances the plate on. Threading
+    /// only applies to plates with enough rows per thread, and while the bow
+    /// is idle, as the bow force depends on the state.
+    /// @param  value       The number of threads, 1 to run on the calling
+    ///                     thread only.
+    /// @param  maxChannels The most channels per frame to run threaded,
+    ///                     beyond which `process` runs on the calling thread.
+    void setNumThreads(int value, int maxChannels = 2);
+
+    /// Set the parameters of the plate.
+    /// @param  value   The desired parameters.
+    void setParameters(const StringParameters &value);
+
+    /// Set the number of columns per tile of the update.
+    /// @param  value   The number of columns.
+    void setTileWidth(int value) { tileWidth = std::max(1, value); };
+
+    /// Strike the plate with a raised cosine force pulse.
+    /// @param  x           The horizontal position as a fraction of the width.
+    /// @param  y           The vertical position as a fraction of the height.
+    /// @param  force       The peak force of the strike.
+    /// @param  duration    The duration of the strike in seconds.
+    void strike(float x, float y, float force, float duration = 0.001);
+
+    private:
+    /// Compute the forces of the strikes and the bow for the coming time
+    /// step.
+    /// @param  f   The forces to add to.
+    /// @param  bowed   Whether to include the bow.
+    void computeForces(SparseForces &f, bool bowed);
+
+    /// Advance the plate one time step and read the pickups.
+    /// @param  frame           Where to write the frame.
+    /// @param  numChannels     The number of channels in the frame.
+    void step(float *frame, int numChannels);
+
+    StringParameters params;
+    PlateCoefficients<float> coeffs;
+    BoundaryCondition boundary = BoundaryCondition::SimplySupported;
+
+    int nx = 0;
+    int ny = 0;
+    int stride = 0;         // The distance between rows of the padded state.
+    float k = 0;            // Sample period.
+    float h = 0;            // Grid spacing.
+    int tileWidth = 1024;   // Columns per tile.
+
+    // The previous, current and next state.
+    std::vector<float> up;
+    std::vector<float> u;
+    std::vector<float> un;
+    SparseForces f;
+
+    PlateBow bow;
+    std::vector<PlateStrike> strikes;
+    ProfileCache envelopes;     // The strike envelopes.
+    PlatePickups pickups;
+    float sampleRate = 44100;
+
+    std::unique_ptr<ParallelPlateSolver> solver;
+};
@@ -0,0 +1,608 @@
+#include "StiffString.h"
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+#ifdef PAL
+#include "pal/Gui.h"
+#endif
+
+#ifdef PAL
+static float plotDouble(void *data, int i)
+{
+    return ((double *)data)[i];
+}
+#endif
+
+StiffString::StiffString(int n, float sampleRate, BoundaryCondition bc) :
+    tableCache(std::make_shared<StringTableCache>()),
+    changed(false),
+    excitations(n, sampleRate),
+    pickups(n)
+{
+    k = 1.0f / sampleRate;
+    latest = tableCache->get(StringParameters(), StringProfile(), n, k, bc);
+    resize(n);
+    blockForces.resize(blockSteps);
+
+    excitations.addBow();
+    pickups.add(0.6);
+}
+
+void StiffString::applyForce(int i, float force)
+{
+    f.add(i, (1 / h) * force);
+}
+
+void StiffString::computeForces()
+{
+    IncrementView<float> current = {u.data(), up.data(), false};
+    IncrementView<float> previous = {u.data(), up.data(), true};
+
+    switch (precision)
+    {
+        case Precision::Double:
+            if (varying)
+                excitations.apply(tables->varyingCoeffsDouble, w.data(), wp.data(), f, k, h);
+            else
+                excitations.apply(coeffsDouble, w.data(), wp.data(), f, k, h);
+            break;
+
+        case Precision::Mixed:
+            if (varying)
+                excitations.apply(tables->varyingCoeffsDouble, current, previous, f, k, h);
+            else
+                excitations.apply(coeffsDouble, current, previous, f, k, h);
+            break;
+
+        default:
+            if (varying)
+                excitations.apply(tables->varyingCoeffs, u.data(), up.data(), f, k, h);
+            else
+                excitations.apply(coeffs, u.data(), up.data(), f, k, h);
+            break;
+    }
+}
+
+void StiffString::draw(bool plot)
+{
+#ifdef PAL
+    excitations.draw();
+    pickups.draw();
+
+    float modulation = tensionModulation;
+
+    if (ImGui::SliderFloat("Tension modulation", &modulation, 0, 1e5, "%.0f", 3))
+        setTensionModulation(modulation);
+
+    ImGui::Text("Energy: %g", energy);
+
+    if (plot && precision == Precision::Double)
+    {
+        ImGui::PlotLines("String", &plotDouble, w.data(), w.size(), 0, "", 0.0001, -0.0001, ImVec2(0, 120));
+    }
+    else if (plot)
+    {
+        ImGui::PlotLines("String", u.data(), u.size(), 0, "", 0.0001, -0.0001, ImVec2(0, 120));
+    }
+#endif
+}
+
+void StiffString::excite()
+{
+    // Displace a raised cosine peaking at one.
+    auto profile = excitations.getProfileCache().getProfile(u.size(), 0.3, 0.1, Interpolation::Linear);
+    float peak = *std::max_element(profile->weights.begin(), profile->weights.end());
+
+    for (int j = 0; j < profile->weights.size(); j++)
+    {
+        int i = profile->index + j;
+        float value = profile->weights[j] / peak;
+
+        if (precision == Precision::Double)
+        {
+            w[i] += value;
+            wp[i] += value;
+            continue;
+        }
+
+        // Displacing both states leaves the increment unchanged.
+        u[i] += value;
+
+        if (precision != Precision::Mixed)
+            up[i] += value;
+    }
+}
+
+float StiffString::getForceGain(const ExcitationPoint &point) const
+{
+    if (varying)
+        return (1 / h) * point.getForceWeight(tables->varyingCoeffs);
+
+    float bf = precision == Precision::Float ? coeffs.bf : coeffsDouble.bf;
+    return (bf / h) * point.norm;
+}
+
+float StiffString::getNext()
+{
+    float y = 0;
+    swapTables();
+    step();
+    readPickups(&y, 1);
+    return y;
+}
+
+void StiffString::getNext(float *frame, int numChannels)
+{
+    swapTables();
+    step();
+    readPickups(frame, numChannels);
+}
+
+void StiffString::extrapolateForce(float force, float i)
+{
+    float il = floor(i);
+    float iu = ceil(i);
+    float c = i - il;
+
+    f.add(il, (1 / h) * (1 - c) * force);
+    f.add(iu, (1 / h) * c * force);
+}
+
+float StiffString::interpolate(const std::vector<float> &v, float i) const
+{
+    float il = floor(i);
+    float iu = ceil(i);
+    float c = i - il;
+
+    return (1 - c) * v[il] + c * v[iu];
+}
+
+void StiffString::modulateTension(double slope)
+{
+    // The integral of (du/dx)^2 is the sum of squared slopes over h.
+    double stretch = std::min(tensionModulation * slope / h, tables->maxStretch);
+
+    coeffsDouble.a0 = tables->coeffsDouble.a0 - 2 * coeffsDouble.t1 * stretch;
+    coeffsDouble.a1 = tables->coeffsDouble.a1 + coeffsDouble.t1 * stretch;
+    coeffs.a0 = coeffsDouble.a0;
+    coeffs.a1 = coeffsDouble.a1;
+}
+
+float StiffString::predict(const ExcitationPoint &point) const
+{
+    IncrementView<float> current = {u.data(), up.data(), false};
+    IncrementView<float> previous = {u.data(), up.data(), true};
+
+    switch (precision)
+    {
+        case Precision::Double:
+            return varying ? point.predict(tables->varyingCoeffsDouble, w.data(), wp.data(), f)
+                : point.predict(coeffsDouble, w.data(), wp.data(), f);
+
+        case Precision::Mixed:
+            return varying ? point.predict(tables->varyingCoeffsDouble, current, previous, f)
+                : point.predict(coeffsDouble, current, previous, f);
+
+        default:
+            return varying ? point.predict(tables->varyingCoeffs, u.data(), up.data(), f)
+                : point.predict(coeffs, u.data(), up.data(), f);
+    }
+}
+
+void StiffString::process(float *out, int numFrames, int numChannels)
+{
+    int frame = 0;
+    swapTables();
+
+    // Bows, hammers and tension modulation make every time step depend on
+    // the last, and the blocked and threaded kernels are for uniform strings
+    // only.
+    bool prescribed = !excitations.hasFeedback() && tensionModulation == 0 && !varying;
+
+    if (precision == Precision::Float && solver && solver->isWorthwhile(u.size()) && prescribed
+        && numChannels <= solver->getMaxChannels())
+    {
+        for (; frame < numFrames; frame += solver->getMaxSteps())
+        {
+            int count = std::min(solver->getMaxSteps(), numFrames - frame);
+            processParallel(out + frame * numChannels, count, numChannels, frame + count == numFrames);
+        }
+
+        return;
+    }
+
+    // Large strings are memory bound, so advance several time steps per pass
+    // over the grid whenever all forces can be known in advance.
+    if (precision == Precision::Float && blockSteps > 1 && u.size() >= 2 * blockTileSize && prescribed)
+    {
+        for (; frame + blockSteps <= numFrames; frame += blockSteps)
+            processBlocked(out + frame * numChannels, numChannels, frame + blockSteps == numFrames);
+    }
+
+    for (; frame < numFrames; frame++)
+    {
+        computeForces();
+        step(frame == numFrames - 1);
+        readPickups(out + frame * numChannels, numChannels);
+    }
+}
+
+void StiffString::processBlocked(float *out, int numChannels, bool measureEnergy)
+{
+    // Forces applied since the last time step belong to the first one.
+    std::swap(f, blockForces[0]);
+
+    for (int step = 0; step < blockSteps; step++)
+        excitations.applyPrescribed(blockForces[step], h);
+
+    std::fill(out, out + blockSteps * numChannels, 0);
+
+    float *states[3] = {up.data(), u.data(), un.data()};
+
+    stiffStringStepBlocked(coeffs, states, blockForces.data(), u.size(), blockSteps, blockTileSize,
+        [&](int step, const float *next, const float *current, int lo, int hi)
+        {
+            pickups.accumulate(next, current, k, lo, hi, out + step * numChannels, numChannels);
+        },
+        measureEnergy ? &energy : nullptr);
+
+    // Rotate the states as many times as `step` would have.
+    for (int step = 0; step < blockSteps; step++)
+    {
+        std::swap(up, u);
+        std::swap(u, un);
+    }
+
+    for (auto &forces : blockForces)
+        forces.clear();
+}
+
+void StiffString::processParallel(float *out, int numFrames, int numChannels, bool measureEnergy)
+{
+    // Forces applied since the last time step belong to the first one.
+    std::swap(f, solver->getForces(0));
+
+    for (int step = 0; step < numFrames; step++)
+        excitations.applyPrescribed(solver->getForces(step), h);
+
+    float *states[3] = {up.data(), u.data(), un.data()};
+    solver->run(coeffs, states, u.size(), numFrames, pickups, k, out, numChannels,
+        measureEnergy ? &energy : nullptr);
+
+    for (int step = 0; step < numFrames; step++)
+    {
+        std::swap(up, u);
+        std::swap(u, un);
+    }
+}
+
+void StiffString::readPickups(float *frame, int numChannels) const
+{
+    switch (precision)
+    {
+        case Precision::Double:
+            pickups.read(w.data(), wp.data(), k, frame, numChannels);
+            break;
+
+        case Precision::Mixed:
+            pickups.read(
+                IncrementView<float>{u.data(), up.data(), false},
+                IncrementView<float>{u.data(), up.data(), true},
+                k, frame, numChannels);
+            break;
+
+        default:
+            pickups.read(u.data(), up.data(), k, frame, numChannels);
+            break;
+    }
+}
+
+void StiffString::reset()
+{
+    std::fill(un.begin(), un.end(), 0);
+    std::fill(u.begin(), u.end(), 0);
+    std::fill(up.begin(), up.end(), 0);
+    std::fill(wn.begin(), wn.end(), 0);
+    std::fill(w.begin(), w.end(), 0);
+    std::fill(wp.begin(), wp.end(), 0);
+    excitations.reset();
+    energy = 0;
+    modulateTension(0);
+}
+
+void StiffString::resize(int n)
+{
+    un.resize(n, 0);
+    u.resize(n, 0);
+    up.resize(n, 0);
+    resizeDoubleState();
+
+    // The tables of the old size no longer fit, so take up the new ones at
+    // once.
+    h = 1.0f / n;
+    excitations.setGridSize(n);
+    pickups.setGridSize(n);
+    auto current = std::atomic_load(&latest);
+    setTables(tableCache->get(current->params, current->profile, n, k, current->boundary));
+    swapTables();
+}
+
+void StiffString::resizeDoubleState()
+{
+    // Only double precision keeps its state in doubles, and only mixed
+    // precision widens it into the scratch space, so a float string frees
+    // both.
+    int n = u.size();
+    int wide = precision == Precision::Double ? n : 0;
+    int space = precision == Precision::Mixed ? 3 * n : 0;
+
+    for (auto v : {&wn, &w, &wp})
+    {
+        if (wide == 0)
+            std::vector<double>().swap(*v);
+        else
+            v->resize(wide, 0);
+    }
+
+    if (space == 0)
+        std::vector<double>().swap(scratch);
+    else
+        scratch.resize(space);
+}
+
+void StiffString::resizeForStability()
+{
+    auto current = std::atomic_load(&latest);
+    int n = computeStableSize(current->params, current->profile, 1 / k);
+    printf("Resize string to %i\n", n);
+    resize(n);
+}
+
+void StiffString::setBoundaryCondition(BoundaryCondition value)
+{
+    auto current = std::atomic_load(&latest);
+    updateTables(current->params, current->profile, value);
+}
+
+void StiffString::setBowForce(float value)
+{
+    if (excitations.getNumBows() > 0)
+    {
+        excitations.getBow(0).fb = value;
+    }
+}
+
+void StiffString::setNumThreads(int value, int maxChannels)
+{
+    if (value > 1)
+        solver.reset(new ParallelStringSolver(value, 64, maxChannels));
+    else
+        solver.reset();
+}
+
+void StiffString::setPrecision(Precision value)
+{
+    if (value == Precision::Half || value == Precision::BFloat16)
+        value = Precision::Float;
+
+    if (value == precision)
+        return;
+
+    // Convert through the current and previous state in double precision.
+    int n = u.size();
+    std::vector<double> current(n);
+    std::vector<double> previous(n);
+
+    for (int i = 0; i < n; i++)
+    {
+        current[i] = precision == Precision::Double ? w[i] : u[i];
+
+        if (precision == Precision::Double)
+            previous[i] = wp[i];
+        else if (precision == Precision::Mixed)
+            previous[i] = (double)u[i] - up[i];
+        else
+            previous[i] = up[i];
+    }
+
+    precision = value;
+    resizeDoubleState();
+
+    for (int i = 0; i < n; i++)
+    {
+        if (precision == Precision::Double)
+        {
+            w[i] = current[i];
+            wp[i] = previous[i];
+        }
+        else
+        {
+            u[i] = current[i];
+            up[i] = precision == Precision::Mixed ? current[i] - previous[i] : previous[i];
+        }
+    }
+}
+
+void StiffString::setParameters(const StringParameters &value)
+{
+    auto current = std::atomic_load(&latest);
+    updateTables(value, current->profile, current->boundary);
+}
+
+void StiffString::setProfile(const StringProfile &value)
+{
+    auto current = std::atomic_load(&latest);
+    updateTables(current->params, value, current->boundary);
+}
+
+void StiffString::setTableCache(const std::shared_ptr<StringTableCache> &value)
+{
+    tableCache = value;
+    auto current = std::atomic_load(&latest);
+    updateTables(current->params, current->profile, current->boundary);
+    swapTables();
+}
+
+void StiffString::setTables(const std::shared_ptr<const StringTables> &value)
+{
+    // The tables may be set from another thread than the one reading the
+    // parameters, so both are published atomically.
+    std::atomic_store(&latest, value);
+    std::atomic_store(&pending, value);
+    changed.store(true, std::memory_order_release);
+}
+
+void StiffString::setTensionModulation(float value)
+{
+    tensionModulation = value;
+    modulateTension(0);
+}
+
+void StiffString::setTemporalBlocking(int steps, int tileSize)
+{
+    // Each time step shifts a tile two points, so a tile must be at least
+    // twice as large as the number of time steps.
+    blockSteps = std::max(1, steps);
+    blockTileSize = std::max(tileSize, 2 * blockSteps);
+    blockForces.resize(blockSteps);
+}
+
+void StiffString::setWavespeedFromFreq(float freq)
+{
+    auto current = std::atomic_load(&latest);
+    StringParameters params = current->params;
+    params.gamma0 = powf(2 * freq, 2);
+    updateTables(params, current->profile, current->boundary);
+}
+
+void StiffString::step(bool measureEnergy)
+{
+    if (varying)
+    {
+        stepVarying(measureEnergy);
+        f.clear();
+        return;
+    }
+
+    double energyDouble = 0;
+    double slope = 0;
+    float slopeFloat = 0;
+
+    // The stretching of the next state is measured in the same sweep that
+    // computes it, and modulates the time step after it.
+    bool modulated = tensionModulation != 0;
+
+    switch (precision)
+    {
+        case Precision::Double:
+            stiffStringStep(coeffsDouble, w.data(), wp.data(), f, wn.data(), w.size(),
+                measureEnergy ? &energyDouble : nullptr, modulated ? &slope : nullptr);
+            std::swap(wp, w);
+            std::swap(w, wn);
+            break;
+
+        case Precision::Mixed:
+            stiffStringIncrementStep(coeffsDouble, u.data(), up.data(), f, u.size(), scratch.data(),
+                measureEnergy ? &energyDouble : nullptr, modulated ? &slope : nullptr);
+            break;
+
+        default:
+            stiffStringStep(coeffs, u.data(), up.data(), f, un.data(), u.size(),
+                measureEnergy ? &energy : nullptr, modulated ? &slopeFloat : nullptr);
+            slope = slopeFloat;
+
+            // Rotate the states, such that the next state becomes the current
+            // one.
+            std::swap(up, u);
+            std::swap(u, un);
+            break;
+    }
+
+    if (measureEnergy && precision != Precision::Float)
+        energy = energyDouble;
+
+    if (modulated)
+        modulateTension(slope);
+
+    f.clear();
+}
+
+void StiffString::stepVarying(bool measureEnergy)
+{
+    int n = u.size();
+    double energyDouble = 0;
+
+    switch (precision)
+    {
+        case Precision::Double:
+            stiffStringVaryingStep(tables->varyingCoeffsDouble, w.data(), wp.data(), f, wn.data(), n,
+                measureEnergy ? &energyDouble : nullptr);
+            std::swap(wp, w);
+            std::swap(w, wn);
+            break;
+
+        case Precision::Mixed:
+        {
+            // Widen the current and previous state, and take the increment of
+            // the next state before narrowing it.
+            double *current = scratch.data();
+            double *previous = current + n;
+            double *next = previous + n;
+
+            for (int i = 0; i < n; i++)
+            {
+                current[i] = u[i];
+                previous[i] = (double)u[i] - up[i];
+            }
+
+            stiffStringVaryingStep(tables->varyingCoeffsDouble, current, previous, f, next, n,
+                measureEnergy ? &energyDouble : nullptr);
+
+            for (int i = 0; i < n; i++)
+            {
+                up[i] = next[i] - current[i];
+                u[i] = next[i];
+            }
+
+            break;
+        }
+
+        default:
+            stiffStringVaryingStep(tables->varyingCoeffs, u.data(), up.data(), f, un.data(), n,
+                measureEnergy ? &energy : nullptr);
+            std::swap(up, u);
+            std::swap(u, un);
+            break;
+    }
+
+    if (measureEnergy && precision != Precision::Float)
+        energy = energyDouble;
+}
+
+void StiffString::swapTables()
+{
+    if (!changed.load(std::memory_order_acquire))
+        return;
+
+    // The tables are set before the flag, so clearing it first never misses
+    // any. The cache holds on to the tables given up, so they are not freed
+    // here.
+    changed.store(false, std::memory_order_relaxed);
+    auto next = std::atomic_exchange(&pending, std::shared_ptr<const StringTables>());
+
+    if (!next || next->n != u.size())
+        return;
+
+    tables = std::move(next);
+    coeffs = tables->coeffs;
+    coeffsDouble = tables->coeffsDouble;
+    varying = tables->varying;
+    pickups.setBridge(tables->scaled, h, tables->boundary);
+    excitations.setFrets(tables->frets);
+}
+
+void StiffString::updateTables(const StringParameters &params, const StringProfile &profile, BoundaryCondition bc)
+{
+    setTables(tableCache->get(params, profile, std::atomic_load(&latest)->n, k, bc));
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include "Excitation.h"
+#include "ParallelSolver.h"
+#include "Pickup.h"
+#include "StringKernel.h"
+#include "StringModel.h"
+#include "StringTables.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/// A stiff string whose number of points is chosen at runtime.
+///
+/// The coefficients live in immutable tables shared with all strings with the
+/// same parameters, so a string only keeps its state. Setting the parameters
+/// makes or finds the tables on the calling thread, and the string takes them
+/// up at the start of the next block or sample it computes, so they can be
+/// set while another thread runs the string.
+class StiffString : public StringModel
+{
+    public:
+    /// Create a new stiff string model
+    /// @param  n           The number of points in the model.
+    /// @param  sampleRate  The sample rate to use (default 44100).
+    /// @param  bc          The boundary condition at both ends.
+    StiffString(
+        int n,
+        float sampleRate = 44100,
+        BoundaryCondition bc = BoundaryCondition::SimplySupported);
+
+    /// Apply a force to the string.
+    /// @param  i       Where to apply the force.
+    /// @param  force   The magnitude of the force to apply.
+    void applyForce(int i, float force) override;
+
+    /// Compute and apply the forces of all bows, plucks and strikes for the
+    /// coming time step.
+    void computeForces() override;
+
+    /// Draw a UI for controlling the string.
+    void draw(bool plot = true) override;
+
+    /// Excite the string by displacing a raised cosine.
+    void excite() override;
+
+    /// Extrapolate a force somewhere on the string.
+    /// @param  force   The magnitude of the force to apply.
+    /// @param  i       Fractional index of where to apply the force.
+    void extrapolateForce(float force, float i);
+
+    /// Compute and get the next output sample.
+    /// @returns    The sum of all pickups.
+    float getNext() override;
+
+    /// Compute the next time step and read all pickups into one frame.
+    /// @param  frame           Where to write the frame.
+    /// @param  numChannels     The number of channels in the frame.
+    void getNext(float *frame, int numChannels) override;
+
+    /// Get the bows, plucks and strikes exciting the string.
+    Excitations &getExcitations() override { return excitations; };
+
+    /// Get how far a force applied at a point with `applyForce` moves the
+    /// point in the next time step.
+    /// @param  point   The point.
+    float getForceGain(const ExcitationPoint &point) const override;
+
+    /// Get the numerical energy of the string, measured during the last time
+    /// step of the last block computed by `process`.
+    float getEnergy() const override { return energy; };
+
+    /// Get the parameters of the string, which stay valid until they are
+    /// next set.
+    const StringParameters &getParameters() const override { return std::atomic_load(&latest)->params; };
+
+    /// Get how the mass and stiffness vary along the string, which stays
+    /// valid until it is next set.
+    const StringProfile &getProfile() const { return std::atomic_load(&latest)->profile; };
+
+    /// Get the number format the string computes in and stores its state in.
+    Precision getPrecision() const { return precision; };
+
+    /// Get the pickups reading the string.
+    Pickups &getPickups() override { return pickups; };
+
+    /// Get the number of points in the string.
+    int getSize() const override { return u.size(); };
+
+    /// Get the linearly interpolated value of a vector at some fractional
+    /// index.
+    /// @param  v   The vector whose values to interpolate.
+    /// @param  i   The fractional index to read at.
+    /// @returns    The interpolated value.
+    float interpolate(const std::vector<float> &v, float i) const;
+
+    /// Predict the value of the string at a point after the next time step,
+    /// from the forces applied so far.
+    /// @param  point   The point.
+    float predict(const ExcitationPoint &point) const override;
+
+    /// Compute a block of output, running the string once per frame and
+    /// reading all pickups from that single pass.
+    /// @param  out             Where to write the interleaved output.
+    /// @param  numFrames       The number of frames to compute.
+    /// @param  numChannels     The number of channels per frame.
+    void process(float *out, int numFrames, int numChannels) override;
+
+    /// Reset the string state to zero.
+    void reset() override;
+
+    /// Resize the string.
+    /// @param  n   The desired number of points in the string.
+    void resize(int n);
+
+    /// Resize the string such that the string will be stable for the chosen
+    /// parameters.
+    void resizeForStability();
+
+    /// Set the boundary condition at both ends.
+    /// @param  value   The desired boundary condition.
+    void setBoundaryCondition(BoundaryCondition value);
+
+    /// Set the force of the first bow.
+    /// @param  value   The desired bow force.
+    void setBowForce(float value) override;
+
+    /// Set the number format the string computes in and stores its state in,
+    /// converting the current state. Temporal blocking and threading only
+    /// apply in float. 16-bit storage is only available to the fixed-size
+    /// strings, so it falls back to float.
+    /// @param  value   The desired number format.
+    void setPrecision(Precision value);
+
+    /// Set the number of threads `process` advances the string on. Like
+    /// temporal blocking, threading only applies to large strings while no bow
+    /// or hammer is active, and takes precedence over it.
+    /// @param  value       The number of threads, 1 to run on the calling
+    ///                     thread only.
+    /// @param  maxChannels The most channels per frame to run threaded,
+    ///                     beyond which `process` runs on the calling thread.
+    void setNumThreads(int value, int maxChannels = 2);
+
+    /// Set all parameters of the string at once.
+    /// @param  value   The desired parameters.
+    void setParameters(const StringParameters &value) override;
+
+    /// Set how the mass and stiffness vary along the string. A string that is
+    /// the same all along runs as fast as one without a profile, with its
+    /// parameters scaled. Otherwise every point has its own coefficients,
+    /// and neither temporal blocking, threading nor tension modulation apply.
+    /// The energy is then measured as if the whole string were like its left
+    /// end.
+    /// @param  value   The desired profile.
+    void setProfile(const StringProfile &value);
+
+    /// Set the strength of the tension modulation, which makes the wave speed
+    /// grow with the stretching of the string, as gamma0 (1 + value times
+    /// the integral of (du/dx)^2) in the Kirchhoff-Carrier model. Loud notes
+    /// then start sharp and glide down as they decay. The wave speed is
+    /// limited to what the grid is stable for, so a string meant to glide far
+    /// needs a grid sized for its highest wave speed. Temporal blocking and
+    /// threading do not apply while the tension is modulated.
+    /// @param  value   The strength, 0 for a linear string.
+    void setTensionModulation(float value);
+
+    /// Set how many time steps `process` advances per pass over the grid.
+    /// Temporal blocking only applies to strings of at least two tiles, and
+    /// only while no bow or hammer is active, as their forces depend on the
+    /// state.
+    /// @param  steps       The number of time steps per pass, 1 to disable.
+    /// @param  tileSize    The number of points per tile.
+    void setTemporalBlocking(int steps, int tileSize = 512);
+
+    /// Set the cache to share the tables of the string through, while
+    /// setting up rather than while the string runs.
+    /// @param  value   The cache.
+    void setTableCache(const std::shared_ptr<StringTableCache> &value) override;
+
+    /// Set the tables the string runs on, which it takes up at the start of
+    /// the next block or sample it computes. The tables must be made for the
+    /// size and sample rate of the string, and tables not held by a cache may
+    /// be freed on the thread running the string.
+    /// @param  value   The tables.
+    void setTables(const std::shared_ptr<const StringTables> &value) override;
+
+    /// Set the wave speed corresponding to a frequency.
+    /// @param  freq    The desired frequency.
+    void setWavespeedFromFreq(float freq) override;
+
+    private:
+    /// Compute `blockSteps` frames of output in a single pass over the grid.
+    /// @param  out             Where to write the interleaved output.
+    /// @param  numChannels     The number of channels per frame.
+    /// @param  measureEnergy   Whether to measure the energy in the last frame.
+    void processBlocked(float *out, int numChannels, bool measureEnergy);
+
+    /// Compute frames of output using the parallel solver.
+    /// @param  out             Where to write the interleaved output.
+    /// @param  numFrames       The number of frames, at most the number of
+    ///                         time steps per run of the solver.
+    /// @param  numChannels     The number of channels per frame.
+    /// @param  measureEnergy   Whether to measure the energy in the last frame.
+    void processParallel(float *out, int numFrames, int numChannels, bool measureEnergy);
+
+    /// Modulate the tension part of the coefficients by the stretching of
+    /// the string.
+    /// @param  slope   The sum of the squared slopes of the state.
+    void modulateTension(double slope);
+
+    /// Read all pickups and write one frame of output.
+    /// @param  frame           Where to write the frame.
+    /// @param  numChannels     The number of channels in the frame.
+    void readPickups(float *frame, int numChannels) const;
+
+    /// Size the double precision state and the scratch space for the number
+    /// format, freeing them in float.
+    void resizeDoubleState();
+
+    /// Advance the string one time step and clear the forces.
+    /// @param  measureEnergy   Whether to measure the energy along the way.
+    void step(bool measureEnergy = false);
+
+    /// Advance the string one time step with the coefficients of every point.
+    /// @param  measureEnergy   Whether to measure the energy along the way.
+    void stepVarying(bool measureEnergy);
+
+    /// Take up the tables set last, if they changed since they were last
+    /// taken up.
+    void swapTables();
+
+    /// Set the tables for a string of the current size from the cache.
+    /// @param  params  The parameters of the string.
+    /// @param  profile How the mass and stiffness vary along the string.
+    /// @param  bc      The boundary condition at both ends.
+    void updateTables(const StringParameters &params, const StringProfile &profile, BoundaryCondition bc);
+
+    // We need three vectors to hold the state of our system at the next,
+    // current and previous timestep. Swapping vectors only exchanges their
+    // buffers, so we avoid copying arrays between time steps.
+    std::vector<float> un;  // Next state.
+    std::vector<float> u;   // Current state.
+    std::vector<float> up;  // Previous state.
+    SparseForces f;         // Forces.
+
+    // The same states in double precision. In mixed precision the state is
+    // kept in increment form instead, with `u` the current state and `up` the
+    // increment, and widened into the scratch space every time step. Both
+    // are empty in float.
+    std::vector<double> wn;
+    std::vector<double> w;
+    std::vector<double> wp;
+    std::vector<double> scratch;
+    Precision precision = Precision::Float;
+
+    // The tables the string runs on, the tables set last, and those waiting
+    // to be taken up at the next block. Only the first are owned by the
+    // audio thread, the others are swapped atomically. The uniform
+    // coefficients are copied out of the tables, as tension modulation
+    // changes them.
+    std::shared_ptr<StringTableCache> tableCache;
+    std::shared_ptr<const StringTables> tables;
+    std::shared_ptr<const StringTables> latest;
+    std::shared_ptr<const StringTables> pending;
+    std::atomic<bool> changed;
+    StringCoefficients<float> coeffs;
+    StringCoefficients<double> coeffsDouble;
+    bool varying = false;
+    Excitations excitations;
+    Pickups pickups;
+
+    float k = 0;            // Sample period.
+    float h = 0;            // Grid spacing.
+    float energy = 0;       // Energy in the last time step of a block.
+
+    float tensionModulation = 0;    // Strength of the tension modulation.
+
+    int blockSteps = 8;                     // Time steps per pass.
+    int blockTileSize = 512;                // Points per tile.
+    std::vector<SparseForces> blockForces;  // Forces of each time step.
+
+    std::unique_ptr<ParallelStringSolver> solver;
+};
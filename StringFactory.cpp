@@ -0,0 +1,83 @@
+#include "StringFactory.h"
+#include "FixedStiffString.h"
+#include "StiffString.h"
+
+// The grid sizes our instruments use, which get compile-time specializations.
+#define FIXED_STIFF_STRING_SIZES(X) X(32) X(48) X(64) X(80) X(96) X(128)
+
+template <int N, BoundaryCondition BC>
+static StringModel *makeFixedStiffString(Precision precision, float sampleRate)
+{
+    switch (precision)
+    {
+        case Precision::Double: return new FixedStiffString<N, BC, double>(sampleRate);
+        case Precision::Mixed: return new FixedStiffString<N, BC, double, float>(sampleRate);
+        case Precision::Half: return new FixedStiffString<N, BC, float, Half>(sampleRate);
+        case Precision::BFloat16: return new FixedStiffString<N, BC, float, BFloat16>(sampleRate);
+        default: return new FixedStiffString<N, BC, float>(sampleRate);
+    }
+}
+
+template <int N>
+static StringModel *makeFixedStiffString(BoundaryCondition bc, Precision precision, float sampleRate)
+{
+    if (bc == BoundaryCondition::Clamped)
+        return makeFixedStiffString<N, BoundaryCondition::Clamped>(precision, sampleRate);
+
+    return makeFixedStiffString<N, BoundaryCondition::SimplySupported>(precision, sampleRate);
+}
+
+std::unique_ptr<StringModel> makeStiffString(
+    int n,
+    const StringParameters &params,
+    BoundaryCondition bc,
+    Precision precision,
+    float sampleRate)
+{
+    StringModel *string = nullptr;
+
+    switch (n)
+    {
+#define X(size) case size: string = makeFixedStiffString<size>(bc, precision, sampleRate); break;
+        FIXED_STIFF_STRING_SIZES(X)
+#undef X
+        default:
+        {
+            StiffString *dynamic = new StiffString(n, sampleRate, bc);
+            dynamic->setPrecision(precision);
+            string = dynamic;
+            break;
+        }
+    }
+
+    string->setParameters(params);
+    return std::unique_ptr<StringModel>(string);
+}
+
+std::unique_ptr<StringModel> makeStiffString(
+    int n,
+    const KernelChoice &kernel,
+    const StringParameters &params,
+    BoundaryCondition bc,
+    float sampleRate)
+{
+    if (kernel.fixed && hasFixedStiffString(n))
+        return makeStiffString(n, params, bc, Precision::Float, sampleRate);
+
+    StiffString *string = new StiffString(n, sampleRate, bc);
+    string->setTemporalBlocking(kernel.blockSteps, kernel.tileSize);
+    string->setNumThreads(kernel.numThreads);
+    string->setParameters(params);
+    return std::unique_ptr<StringModel>(string);
+}
+
+bool hasFixedStiffString(int n)
+{
+    switch (n)
+    {
+#define X(size) case size: return true;
+        FIXED_STIFF_STRING_SIZES(X)
+#undef X
+        default: return false;
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Excitation.h"
+#include "Pickup.h"
+#include "StringModel.h"
+#include <memory>
+
+/// Which of the interchangeable kernels a stiff string runs on, all of which
+/// compute the same result at different speeds, as chosen by `KernelTuner`.
+/// The defaults are what `makeStiffString` uses without a choice.
+struct KernelChoice
+{
+    bool fixed = true;      // Whether to use a compile-time specialization
+                            // if one exists for the size.
+    int blockSteps = 8;     // Time steps per pass of temporal blocking.
+    int tileSize = 512;     // Points per tile of temporal blocking.
+    int numThreads = 1;     // Threads to advance the string on.
+};
+
+/// Create a stiff string model, using a compile-time specialization when one
+/// exists for the requested size and falling back to the dynamically sized
+/// `StiffString` otherwise.
+/// @param  n           The number of points in the model.
+/// @param  params      The initial parameters of the string.
+/// @param  bc          The boundary condition at both ends.
+/// @param  precision   The number format of the arithmetic and state. 16-bit
+///                     storage is only available to the specializations.
+/// @param  sampleRate  The sample rate to use (default 44100).
+/// @returns            The created string.
+std::unique_ptr<StringModel> makeStiffString(
+    int n,
+    const StringParameters &params = StringParameters(),
+    BoundaryCondition bc = BoundaryCondition::SimplySupported,
+    Precision precision = Precision::Float,
+    float sampleRate = 44100);
+
+/// Create a stiff string model computing in float on a chosen kernel.
+/// @param  n           The number of points in the model.
+/// @param  kernel      The kernel to use. A specialization is only used if
+///                     one exists for the size, and temporal blocking and
+///                     threading only apply to the dynamically sized string.
+/// @param  params      The initial parameters of the string.
+/// @param  bc          The boundary condition at both ends.
+/// @param  sampleRate  The sample rate to use (default 44100).
+/// @returns            The created string.
+std::unique_ptr<StringModel> makeStiffString(
+    int n,
+    const KernelChoice &kernel,
+    const StringParameters &params = StringParameters(),
+    BoundaryCondition bc = BoundaryCondition::SimplySupported,
+    float sampleRate = 44100);
+
+/// Check whether a compile-time specialization exists for a string size.
+/// @param  n   The number of points in the model.
+/// @returns    True if `makeStiffString` will use a specialization.
+bool hasFixedStiffString(int n);
@@ -0,0 +1,985 @@
+#pragma once
+
+#include "StringModel.h"
+#include <cmath>
+#include <vector>
+
+/// The coefficients of the stiff string scheme, folded such that one time
+/// step reduces to a symmetric 5-point stencil over the current state and a
+/// 3-point stencil over the previous state.
+template <typename Real>
+struct StringCoefficients
+{
+    Real a0 = 0;    // Weight of u[i].
+    Real a1 = 0;    // Weight of u[i-1] and u[i+1].
+    Real a2 = 0;    // Weight of u[i-2] and u[i+2].
+    Real b0 = 0;    // Weight of up[i].
+    Real b1 = 0;    // Weight of up[i-1] and up[i+1].
+    Real bf = 0;    // Weight of the force density f[i].
+    Real edge = 0;  // Ghost point correction of a0 at the outermost points.
+    Real t1 = 0;    // The part of a1 due to tension, which a0 holds twice
+                    // with opposite sign.
+
+    // The numerical energy is a weighted sum of the squared velocity and the
+    // products of the current and previous slope and curvature.
+    Real kinetic = 0;   // Weight of (u[i] - up[i])^2.
+    Real tension = 0;   // Weight of the product of first differences.
+    Real stiffness = 0; // Weight of the product of second differences.
+    Real ghost = 0;     // The ghost point as a multiple of the outermost one.
+
+    /// Fold the parameters into coefficients.
+    /// @param  p   The string parameters.
+    /// @param  k   The sample period.
+    /// @param  h   The grid spacing.
+    /// @param  bc  The boundary condition at both ends.
+    void compute(const StringParameters &p, double k, double h, BoundaryCondition bc)
+    {
+        double c1 = 1 / (1 + p.sigma0 * k);
+        double k2 = k * k;
+        double h2 = h * h;
+        double lambda2 = k2 * p.gamma0 / h2;
+        double mu2 = k2 * p.kappa0 / (h2 * h2);
+        double s = 2 * p.sigma1 * k / h2;
+
+        a0 = c1 * (2 - 2 * lambda2 - 6 * mu2 - 2 * s);
+        a1 = c1 * (lambda2 + 4 * mu2 + s);
+        t1 = c1 * lambda2;
+        a2 = c1 * -mu2;
+        b0 = c1 * (p.sigma0 * k - 1 + 2 * s);
+        b1 = c1 * -s;
+        bf = c1 * k2;
+
+        // The point beyond the boundary mirrors the outermost point, with
+        // opposite sign for a simply supported end.
+        ghost = bc == BoundaryCondition::Clamped ? 1 : -1;
+        edge = ghost * a2;
+
+        kinetic = h / (2 * k2);
+        tension = p.gamma0 / (2 * h);
+        stiffness = p.kappa0 / (2 * h2 * h);
+    }
+};
+
+/// The coefficients of a string whose mass and stiffness vary along it, with
+/// one value per point in a separate array for each, such that the update
+/// streams them alongside the state. The bending stiffness enters as the
+/// second difference of the stiffness times the curvature, which keeps the
+/// scheme conservative, so the weights of the left and right neighbours of
+/// a point differ.
+template <typename Real>
+struct VaryingCoefficients
+{
+    std::vector<Real> a0;   // Weight of u[i], including the ghost point at
+                            // the outermost points.
+    std::vector<Real> l1;   // Weight of u[i-1].
+    std::vector<Real> r1;   // Weight of u[i+1].
+    std::vector<Real> l2;   // Weight of u[i-2].
+    std::vector<Real> r2;   // Weight of u[i+2].
+    std::vector<Real> bf;   // Weight of the force density f[i].
+    Real b0 = 0;            // Weight of up[i].
+    Real b1 = 0;            // Weight of up[i-1] and up[i+1].
+
+    // The numerical energy weighs the squared velocity by the mass, and the
+    // product of the current and previous curvature by the stiffness, of
+    // each point.
+    std::vector<Real> kinetic;      // Weight of (u[i] - up[i])^2.
+    std::vector<Real> curvature;    // Weight of the product of second
+                                    // differences centred on u[i].
+    Real tension = 0;               // Weight of the product of first
+                                    // differences.
+    Real left = 0;                  // Weight of u[0] * up[0] for the slope
+                                    // and curvature at the left end.
+    Real right = 0;                 // Weight of u[n-1] * up[n-1] at the right
+                                    // end.
+
+    /// Fold the parameters and how they vary into coefficients.
+    /// @param  p       The parameters of the uniform string.
+    /// @param  profile How the mass and stiffness vary along the string.
+    /// @param  k       The sample period.
+    /// @param  h       The grid spacing.
+    /// @param  bc      The boundary condition at both ends.
+    /// @param  n       The number of points.
+    void compute(const StringParameters &p, const StringProfile &profile, double k, double h, BoundaryCondition bc, int n)
+    {
+        double c1 = 1 / (1 + p.sigma0 * k);
+        double k2 = k * k;
+        double h2 = h * h;
+        double lambda2 = k2 * p.gamma0 / h2;
+        double mu2 = k2 * p.kappa0 / (h2 * h2);
+        double s = 2 * p.sigma1 * k / h2;
+        double ghost = bc == BoundaryCondition::Clamped ? 1 : -1;
+
+        // The stiffness from the fixed point beyond one end to the one
+        // beyond the other.
+        std::vector<double> stiffness(n + 2);
+
+        for (int i = -1; i <= n; i++)
+            stiffness[i + 1] = StringProfile::at(profile.stiffness, (i + 1.0) / (n + 1));
+
+        for (auto v : {&a0, &l1, &r1, &l2, &r2, &bf, &kinetic, &curvature})
+            v->resize(n);
+
+        b0 = c1 * (p.sigma0 * k - 1 + 2 * s);
+        b1 = c1 * -s;
+
+        // The curvature at a fixed end is that of the ghost point beyond it,
+        // and counts half, as for the uniform string.
+        tension = p.gamma0 / (2 * h);
+        left = tension + (1 + ghost) * p.kappa0 * stiffness[0] / (2 * h2 * h);
+        right = tension + (1 + ghost) * p.kappa0 * stiffness[n+1] / (2 * h2 * h);
+
+        for (int i = 0; i < n; i++)
+        {
+            // Tension and bending act on the mass of the point, while both
+            // damping rates are the same along the string.
+            double g = 1 / StringProfile::at(profile.mass, (i + 1.0) / (n + 1));
+            double sl = stiffness[i];
+            double sc = stiffness[i + 1];
+            double sr = stiffness[i + 2];
+
+            a0[i] = c1 * (2 - 2 * lambda2 * g - mu2 * g * (sl + 4 * sc + sr) - 2 * s);
+            l1[i] = c1 * (lambda2 * g + 2 * mu2 * g * (sl + sc) + s);
+            r1[i] = c1 * (lambda2 * g + 2 * mu2 * g * (sc + sr) + s);
+            l2[i] = c1 * -mu2 * g * sl;
+            r2[i] = c1 * -mu2 * g * sr;
+            bf[i] = c1 * k2 * g;
+            kinetic[i] = h / (2 * k2 * g);
+            curvature[i] = p.kappa0 * sc / (2 * h2 * h);
+        }
+
+        // Fold the ghost points beyond the ends into the outermost points,
+        // and drop the weights of the fixed points, which are zero.
+        a0[0] += ghost * l2[0];
+        a0[n-1] += ghost * r2[n-1];
+        l1[0] = l2[0] = l2[1] = 0;
+        r1[n-1] = r2[n-1] = r2[n-2] = 0;
+    }
+};
+
+/// The forces applied to a string during one time step. Only a few points are
+/// ever excited at once, so the forces are kept as a short list of
+/// (index, force density) pairs rather than a value for every point.
+class SparseForces
+{
+    public:
+    SparseForces() { entries.reserve(16); };
+
+    /// Add a force density at a point. Several forces may be added at the
+    /// same point, in which case they are summed.
+    /// @param  i       The index of the point.
+    /// @param  value   The force density.
+    void add(int i, float value) { entries.push_back({i, value}); };
+
+    /// Apply the forces to a state.
+    /// @param  un      The state to apply the forces to.
+    /// @param  weight  The weight of a force density in the state.
+    template <typename Storage, typename Real>
+    void apply(Storage *un, Real weight) const
+    {
+        for (const auto &entry : entries)
+            un[entry.index] += weight * entry.value;
+    }
+
+    /// Apply the forces to a state, with a weight for every point.
+    /// @param  un      The state to apply the forces to.
+    /// @param  weights The weight of a force density at each point.
+    template <typename Storage, typename Real>
+    void applyWeighted(Storage *un, const Real *weights) const
+    {
+        for (const auto &entry : entries)
+            un[entry.index] += weights[entry.index] * entry.value;
+    }
+
+    /// Apply the forces at points in a range of a state.
+    /// @param  un      The state to apply the forces to.
+    /// @param  weight  The weight of a force density in the state.
+    /// @param  lo      The first point of the range.
+    /// @param  hi      One past the last point of the range.
+    template <typename Storage, typename Real>
+    void applyRange(Storage *un, Real weight, int lo, int hi) const
+    {
+        for (const auto &entry : entries)
+        {
+            if (entry.index >= lo && entry.index < hi)
+                un[entry.index] += weight * entry.value;
+        }
+    }
+
+    /// Get the total force density at a point.
+    /// @param  i   The index of the point.
+    float at(int i) const
+    {
+        float value = 0;
+
+        for (const auto &entry : entries)
+            value += entry.index == i ? entry.value : 0;
+
+        return value;
+    }
+
+    /// Remove all forces, keeping the allocated memory.
+    void clear() { entries.clear(); };
+
+    /// Get the index of the point of an (index, force density) pair.
+    /// @param  j   The index of the pair.
+    int index(int j) const { return entries[j].index; };
+
+    /// Get the number of (index, force density) pairs.
+    int size() const { return entries.size(); };
+
+    /// Get the force density of an (index, force density) pair.
+    /// @param  j   The index of the pair.
+    float value(int j) const { return entries[j].value; };
+
+    private:
+    struct Entry
+    {
+        int index;
+        float value;
+    };
+
+    std::vector<Entry> entries;
+};
+
+// The kernels below take the type the scheme computes in (Real) and the type
+// the state is stored in (Storage) separately, such that the state can be
+// kept in a narrower format than the arithmetic (see Float16.h). Functions
+// that only read a few points accept any indexable State, such as a pointer
+// or an `IncrementView`.
+
+/// Compute the update of a single interior point without any applied force.
+/// @param  c   The folded coefficients.
+/// @param  u   The current state.
+/// @param  up  The previous state.
+/// @param  i   The index to compute, must be in [2, n - 3].
+/// @returns    The value of the point at the next time step.
+template <typename Real, typename State>
+inline Real stiffStringRow(const StringCoefficients<Real> &c, const State &u, const State &up, int i)
+{
+    return c.a0 * u[i] + c.a1 * (u[i-1] + u[i+1]) + c.a2 * (u[i-2] + u[i+2])
+        + c.b0 * up[i] + c.b1 * (up[i-1] + up[i+1]);
+}
+
+/// Compute the update of a single interior point of a string whose mass and
+/// stiffness vary, without any applied force.
+/// @param  c   The folded coefficients.
+/// @param  u   The current state.
+/// @param  up  The previous state.
+/// @param  i   The index to compute, must be in [2, n - 3].
+/// @returns    The value of the point at the next time step.
+template <typename Real, typename State>
+inline Real stiffStringRow(const VaryingCoefficients<Real> &c, const State &u, const State &up, int i)
+{
+    return c.a0[i] * u[i] + c.l1[i] * u[i-1] + c.r1[i] * u[i+1] + c.l2[i] * u[i-2] + c.r2[i] * u[i+2]
+        + c.b0 * up[i] + c.b1 * (up[i-1] + up[i+1]);
+}
+
+/// Get the weight of a force density at a point in the next state.
+/// @param  c   The folded coefficients.
+/// @param  i   The index of the point.
+template <typename Real>
+inline Real stiffStringForceWeight(const StringCoefficients<Real> &c, int i)
+{
+    return c.bf;
+}
+
+/// Get the weight of a force density at a point in the next state of a
+/// string whose mass and stiffness vary.
+/// @param  c   The folded coefficients.
+/// @param  i   The index of the point.
+template <typename Real>
+inline Real stiffStringForceWeight(const VaryingCoefficients<Real> &c, int i)
+{
+    return c.bf[i];
+}
+
+/// Compute the energy contributed by an interior point, from the state
+/// between it and the two points to its left only, such that adjacent ranges
+/// of points can be summed separately.
+/// @param  c   The folded coefficients.
+/// @param  u   The current state.
+/// @param  up  The previous state.
+/// @param  i   The index of the point, must be in [2, n - 1].
+/// @returns    The energy of the point.
+template <typename Real, typename State>
+inline Real stiffStringEnergyInner(const StringCoefficients<Real> &c, const State &u, const State &up, int i)
+{
+    Real v = (Real)u[i] - up[i];
+    Real slope = (Real)u[i] - u[i-1];
+    Real slopep = (Real)up[i] - up[i-1];
+    Real curve = (Real)u[i] - 2 * (Real)u[i-1] + u[i-2];
+    Real curvep = (Real)up[i] - 2 * (Real)up[i-1] + up[i-2];
+
+    return c.kinetic * v * v + c.tension * slope * slopep + c.stiffness * curve * curvep;
+}
+
+/// Compute the energy contributed by any point, including the terms that
+/// reach beyond the ends at the outermost points.
+/// @param  c   The folded coefficients.
+/// @param  u   The current state.
+/// @param  up  The previous state.
+/// @param  i   The index of the point.
+/// @param  n   The number of points.
+/// @returns    The energy of the point.
+template <typename Real, typename State>
+inline Real stiffStringEnergy(const StringCoefficients<Real> &c, const State &u, const State &up, int i, int n)
+{
+    // A clamped end adds twice the outermost point to its stiffness row,
+    // which a simply supported end does not.
+    Real e = 0;
+    Real g = 1 + c.ghost;
+
+    if (i >= 2)
+    {
+        e = stiffStringEnergyInner(c, u, up, i);
+    }
+    else if (i == 1)
+    {
+        Real v = (Real)u[1] - up[1];
+        e = c.kinetic * v * v
+            + c.tension * ((Real)u[1] - u[0]) * ((Real)up[1] - up[0])
+            + c.stiffness * ((Real)u[1] - 2 * (Real)u[0]) * ((Real)up[1] - 2 * (Real)up[0]);
+    }
+    else
+    {
+        // u[-1] is zero, which leaves the curvature at 0 to the next point.
+        Real v = (Real)u[0] - up[0];
+        e = c.kinetic * v * v + (c.tension + c.stiffness * g) * u[0] * up[0];
+    }
+
+    if (i == n - 1)
+    {
+        // Close the sums at the right end, mirroring the left end.
+        e += (c.tension + c.stiffness * g) * u[n-1] * up[n-1]
+            + c.stiffness * ((Real)u[n-2] - 2 * (Real)u[n-1]) * ((Real)up[n-2] - 2 * (Real)up[n-1]);
+    }
+
+    return e;
+}
+
+/// Compute the energy contributed by an interior point of a string whose mass
+/// and stiffness vary, from the state between it and the two points to its
+/// left only.
+/// @param  c   The folded coefficients.
+/// @param  u   The current state.
+/// @param  up  The previous state.
+/// @param  i   The index of the point, must be in [2, n - 1].
+/// @returns    The energy of the point.
+template <typename Real, typename State>
+inline Real stiffStringEnergyInner(const VaryingCoefficients<Real> &c, const State &u, const State &up, int i)
+{
+    Real v = (Real)u[i] - up[i];
+    Real slope = (Real)u[i] - u[i-1];
+    Real slopep = (Real)up[i] - up[i-1];
+    Real curve = (Real)u[i] - 2 * (Real)u[i-1] + u[i-2];
+    Real curvep = (Real)up[i] - 2 * (Real)up[i-1] + up[i-2];
+
+    return c.kinetic[i] * v * v + c.tension * slope * slopep + c.curvature[i-1] * curve * curvep;
+}
+
+/// Compute the energy contributed by any point of a string whose mass and
+/// stiffness vary, including the terms that reach beyond the ends at the
+/// outermost points.
+/// @param  c   The folded coefficients.
+/// @param  u   The current state.
+/// @param  up  The previous state.
+/// @param  i   The index of the point.
+/// @param  n   The number of points.
+/// @returns    The energy of the point.
+template <typename Real, typename State>
+inline Real stiffStringEnergy(const VaryingCoefficients<Real> &c, const State &u, const State &up, int i, int n)
+{
+    Real e = 0;
+
+    if (i >= 2)
+    {
+        e = stiffStringEnergyInner(c, u, up, i);
+    }
+    else if (i == 1)
+    {
+        Real v = (Real)u[1] - up[1];
+        e = c.kinetic[1] * v * v
+            + c.tension * ((Real)u[1] - u[0]) * ((Real)up[1] - up[0])
+            + c.curvature[0] * ((Real)u[1] - 2 * (Real)u[0]) * ((Real)up[1] - 2 * (Real)up[0]);
+    }
+    else
+    {
+        Real v = (Real)u[0] - up[0];
+        e = c.kinetic[0] * v * v + c.left * u[0] * up[0];
+    }
+
+    if (i == n - 1)
+    {
+        e += c.right * u[n-1] * up[n-1]
+            + c.curvature[n-1] * ((Real)u[n-2] - 2 * (Real)u[n-1]) * ((Real)up[n-2] - 2 * (Real)up[n-1]);
+    }
+
+    return e;
+}
+
+/// Compute the squared slope between a point and the one to its left, which
+/// summed over all points gives the integral of (du/dx)^2 times h. At the
+/// outermost points it includes the slope to the fixed ends.
+/// @param  u   The state.
+/// @param  i   The index of the point.
+/// @param  n   The number of points.
+/// @returns    The squared difference.
+template <typename Real, typename State>
+inline Real stiffStringSlope(const State &u, int i, int n)
+{
+    Real d = i == 0 ? (Real)u[0] : (Real)u[i] - u[i-1];
+    Real s = d * d;
+
+    if (i == n - 1)
+        s += (Real)u[n-1] * u[n-1];
+
+    return s;
+}
+
+/// Compute how much applying forces to a state changed the sum of its squared
+/// slopes, which only changes next to the few points they touch. As in
+/// `stiffStringSlope`, the slopes of the outermost points include those to
+/// the fixed ends.
+/// @param  forces  The forces, applied to any points.
+/// @param  un      The state, after the forces were applied.
+/// @param  n       The number of points.
+/// @param  weight  The weight of a force density in the state.
+/// @returns        The change of the sum.
+template <typename Real, typename Storage>
+inline Real stiffStringForcedSlope(const SparseForces &forces, const Storage *un, int n, Real weight)
+{
+    // The state is zero at the fixed points beyond either end.
+    auto at = [&](int i) { return i >= 0 && i < n ? (Real)un[i] : 0; };
+    Real change = 0;
+
+    for (int j = 0; j < forces.size(); j++)
+    {
+        // A force changes the slopes to both sides of its point. Count each
+        // slope once, even if several forces change it.
+        for (int i = forces.index(j); i <= forces.index(j) + 1; i++)
+        {
+            bool seen = false;
+
+            for (int q = 0; q < j; q++)
+                seen = seen || forces.index(q) == i - 1 || forces.index(q) == i;
+
+            if (seen)
+                continue;
+
+            Real after = at(i) - at(i - 1);
+            Real before = after - weight * (forces.at(i) - forces.at(i - 1));
+            change += after * after - before * before;
+        }
+    }
+
+    return change;
+}
+
+/// Compute the inner points of the increment form, from the third to the third
+/// last.
+/// @tparam Slope   Whether to sum the squared slopes of the next state.
+/// @returns        The sum of the squared slopes between the second and the
+///                 third last point, or zero.
+template <bool Slope, typename Real, typename Storage>
+inline Real stiffStringIncrementInner(
+    Real p0, Real p1, Real p2, Real q0, Real q1,
+    const Real *uw,
+    const Real *dw,
+    Storage *u,
+    Storage *d,
+    int n)
+{
+    Real s = 0;
+    Real left = Slope ? (Real)u[1] : 0;
+
+    for (int i = 2; i < n - 2; i++)
+    {
+        Real x = p0 * uw[i] + p1 * (uw[i-1] + uw[i+1]) + p2 * (uw[i-2] + uw[i+2])
+            + q0 * dw[i] + q1 * (dw[i-1] + dw[i+1]);
+        d[i] = x;
+        u[i] = uw[i] + x;
+
+        if (Slope)
+        {
+            Real next = uw[i] + x;
+            s += (next - left) * (next - left);
+            left = next;
+        }
+    }
+
+    return s;
+}
+
+/// Compute the update of one of the two outermost points at either end.
+/// @param  c   The folded coefficients.
+/// @param  u   The current state.
+/// @param  up  The previous state.
+/// @param  i   The index to compute, one of 0, 1, n - 2 and n - 1.
+/// @param  n   The number of points.
+/// @returns    The value of the point at the next time step.
+template <typename Real, typename Storage>
+inline Real stiffStringEdgeRow(const StringCoefficients<Real> &c, const Storage *u, const Storage *up, int i, int n)
+{
+    // At the left end u[-1] is zero and u[-2] is a ghost point, the right end
+    // mirrors the left.
+    if (i == 0)
+    {
+        return (c.a0 + c.edge) * u[0] + c.a1 * u[1] + c.a2 * u[2]
+            + c.b0 * up[0] + c.b1 * up[1];
+    }
+    else if (i == 1)
+    {
+        return c.a0 * u[1] + c.a1 * (u[0] + u[2]) + c.a2 * u[3]
+            + c.b0 * up[1] + c.b1 * (up[0] + up[2]);
+    }
+    else if (i == n - 2)
+    {
+        return c.a0 * u[n-2] + c.a1 * (u[n-3] + u[n-1]) + c.a2 * u[n-4]
+            + c.b0 * up[n-2] + c.b1 * (up[n-3] + up[n-1]);
+    }
+
+    return (c.a0 + c.edge) * u[n-1] + c.a1 * u[n-2] + c.a2 * u[n-3]
+        + c.b0 * up[n-1] + c.b1 * up[n-2];
+}
+
+/// Compute the next state of the inner points in a range, measuring only
+/// what is asked for, such that the loop without measurements stays as lean
+/// as possible.
+template <bool Energy, bool Slope, typename Real, typename Storage>
+inline void stiffStringInner(
+    const StringCoefficients<Real> &c,
+    const Storage *u,
+    const Storage *up,
+    Storage *un,
+    int lo,
+    int hi,
+    Real &e,
+    Real &s)
+{
+    Real left = Slope ? (Real)un[lo-1] : 0;
+
+    for (int i = lo; i < hi; i++)
+    {
+        Real x = c.a0 * u[i] + c.a1 * (u[i-1] + u[i+1]) + c.a2 * (u[i-2] + u[i+2])
+            + c.b0 * up[i] + c.b1 * (up[i-1] + up[i+1]);
+        un[i] = x;
+
+        if (Energy)
+            e += stiffStringEnergyInner(c, u, up, i);
+
+        if (Slope)
+        {
+            s += (x - left) * (x - left);
+            left = x;
+        }
+    }
+}
+
+/// Compute the next state of the points in a range, without forces.
+/// @param  c       The folded coefficients.
+/// @param  u       The current state.
+/// @param  up      The previous state.
+/// @param  un      Where to write the next state.
+/// @param  n       The number of points, must be at least 4.
+/// @param  lo      The first point of the range.
+/// @param  hi      One past the last point of the range.
+/// @param  energy  If not null, the energy of the range between the previous
+///                 and current state is added to it, from the same loads.
+/// @param  slope   If not null, the squared slopes of the next state over the
+///                 range are added to it as it is written, which needs the
+///                 point left of the range to be final.
+template <typename Real, typename Storage>
+inline void stiffStringRange(
+    const StringCoefficients<Real> &c,
+    const Storage *u,
+    const Storage *up,
+    Storage *un,
+    int n,
+    int lo,
+    int hi,
+    Real *energy = nullptr,
+    Real *slope = nullptr)
+{
+    int i = lo;
+    Real e = 0;
+    Real s = 0;
+
+    for (; i < hi && i < 2; i++)
+    {
+        un[i] = stiffStringEdgeRow(c, u, up, i, n);
+
+        if (energy)
+            e += stiffStringEnergy(c, u, up, i, n);
+
+        if (slope)
+            s += stiffStringSlope<Real>(un, i, n);
+    }
+
+    int end = hi < n - 2 ? hi : n - 2;
+
+    if (i < end)
+    {
+        if (energy && slope)
+            stiffStringInner<true, true>(c, u, up, un, i, end, e, s);
+        else if (energy)
+            stiffStringInner<true, false>(c, u, up, un, i, end, e, s);
+        else if (slope)
+            stiffStringInner<false, true>(c, u, up, un, i, end, e, s);
+        else
+            stiffStringInner<false, false>(c, u, up, un, i, end, e, s);
+
+        i = end;
+    }
+
+    for (; i < hi; i++)
+    {
+        un[i] = stiffStringEdgeRow(c, u, up, i, n);
+
+        if (energy)
+            e += stiffStringEnergy(c, u, up, i, n);
+
+        if (slope)
+            s += stiffStringSlope<Real>(un, i, n);
+    }
+
+    if (energy)
+        *energy += e;
+
+    if (slope)
+        *slope += s;
+}
+
+/// Advance the string one time step.
+/// @param  c       The folded coefficients.
+/// @param  u       The current state.
+/// @param  up      The previous state.
+/// @param  forces  The forces applied during the time step.
+/// @param  un      Where to write the next state.
+/// @param  n       The number of points, must be at least 4.
+/// @param  energy  If not null, set to the energy between the previous and
+///                 current state.
+/// @param  slope   If not null, set to the sum of the squared slopes of the
+///                 next state.
+template <typename Real, typename Storage>
+inline void stiffStringStep(
+    const StringCoefficients<Real> &c,
+    const Storage *u,
+    const Storage *up,
+    const SparseForces &forces,
+    Storage *un,
+    int n,
+    Real *energy = nullptr,
+    Real *slope = nullptr)
+{
+    if (energy)
+        *energy = 0;
+
+    if (slope)
+        *slope = 0;
+
+    stiffStringRange(c, u, up, un, n, 0, n, energy, slope);
+
+    // Add the forces at the few points they touch.
+    forces.apply(un, c.bf);
+
+    if (slope)
+        *slope += stiffStringForcedSlope(forces, un, n, c.bf);
+}
+
+/// Advance the string several time steps in a single pass over the grid.
+///
+/// The grid is split into tiles that are small enough to stay in cache, and
+/// every tile is advanced all time steps before moving on to the next. The
+/// stencil reaches two points to either side, so each time step of a tile is
+/// shifted two points to the left of the previous one. All values it needs
+/// have then already been computed, either by the tile itself or by the tile
+/// to its left, and none have yet been overwritten. The result is identical
+/// to advancing the whole string one time step at a time.
+///
+/// @param  c           The folded coefficients.
+/// @param  states      The previous, current and next state. After `numSteps`
+///                     time steps the latest state is in
+///                     `states[(numSteps + 1) % 3]`.
+/// @param  forces      The forces of each time step, known in advance.
+/// @param  n           The number of points, must be at least 4.
+/// @param  numSteps    The number of time steps to advance.
+/// @param  tileSize    The number of points per tile, at least 2 `numSteps`.
+/// @param  observe     Called as `observe(step, un, u, lo, hi)` once the points
+///                     in [lo, hi) of time step `step` are final, while both
+///                     that and the previous state are still available there.
+/// @param  energy      If not null, set to the energy between the previous
+///                     and current state of the last time step.
+template <typename Real, typename Storage, typename Observer>
+void stiffStringStepBlocked(
+    const StringCoefficients<Real> &c,
+    Storage *const *states,
+    const SparseForces *forces,
+    int n,
+    int numSteps,
+    int tileSize,
+    Observer &&observe,
+    Real *energy = nullptr)
+{
+    int numTiles = (n + tileSize - 1) / tileSize;
+
+    if (energy)
+        *energy = 0;
+
+    for (int tile = 0; tile < numTiles; tile++)
+    {
+        for (int step = 0; step < numSteps; step++)
+        {
+            int lo = tile == 0 ? 0 : tile * tileSize - 2 * step;
+            int hi = tile == numTiles - 1 ? n : (tile + 1) * tileSize - 2 * step;
+
+            const Storage *up = states[step % 3];
+            const Storage *u = states[(step + 1) % 3];
+            Storage *un = states[(step + 2) % 3];
+
+            stiffStringRange(c, u, up, un, n, lo, hi, step == numSteps - 1 ? energy : nullptr);
+            forces[step].applyRange(un, c.bf, lo, hi);
+            observe(step, (const Storage *)un, u, lo, hi);
+        }
+    }
+}
+
+/// A read-only view of the current or previous state of a string stored in
+/// increment form, which can be indexed like the state itself.
+template <typename Storage, typename Real = float>
+struct IncrementView
+{
+    const Storage *u;   // The current state.
+    const Storage *d;   // The increment from the previous to the current state.
+    bool previous;      // Whether to view the previous state.
+
+    Real operator[](int i) const { return previous ? (Real)u[i] - d[i] : (Real)u[i]; }
+};
+
+/// Advance the string one time step, with the state stored in increment form.
+///
+/// A state narrower than the arithmetic loses most of its precision in the
+/// usual form, as the scheme subtracts the previous state from nearly twice
+/// the current one. Instead, this keeps the current state u and the increment
+/// d = u - up. The increment is small and updated directly, and u only enters
+/// the update through the small stiffness and tension terms, so rounding
+/// either when stored stays small.
+///
+/// @param  c       The folded coefficients.
+/// @param  u       The current state, which is replaced by the next one.
+/// @param  d       The increment, which is replaced by the next one.
+/// @param  forces  The forces applied during the time step.
+/// @param  n       The number of points, must be at least 4.
+/// @param  scratch Room for 2 n values, into which the state is widened.
+/// @param  energy  If not null, set to the energy between the previous and
+///                 current state.
+/// @param  slope   If not null, set to the sum of the squared slopes of the
+///                 next state.
+template <typename Real, typename Storage>
+inline void stiffStringIncrementStep(
+    const StringCoefficients<Real> &c,
+    Storage *u,
+    Storage *d,
+    const SparseForces &forces,
+    int n,
+    Real *scratch,
+    Real *energy = nullptr,
+    Real *slope = nullptr)
+{
+    // Substitute up = u - d and subtract u from the folded stencil.
+    Real p0 = c.a0 + c.b0 - 1;
+    Real p1 = c.a1 + c.b1;
+    Real p2 = c.a2;
+    Real q0 = -c.b0;
+    Real q1 = -c.b1;
+
+    // Widen the state once, such that the stencil only reads Real values.
+    Real *uw = scratch;
+    Real *dw = scratch + n;
+
+    if (energy)
+    {
+        // The energy of a point only reads the points to its left, which
+        // have already been widened.
+        IncrementView<Real, Real> current = {uw, dw, false};
+        IncrementView<Real, Real> previous = {uw, dw, true};
+        Real e = 0;
+
+        for (int i = 0; i < n; i++)
+        {
+            uw[i] = u[i];
+            dw[i] = d[i];
+            e += stiffStringEnergy(c, current, previous, i, n);
+        }
+
+        *energy = e;
+    }
+    else
+    {
+        for (int i = 0; i < n; i++)
+        {
+            uw[i] = u[i];
+            dw[i] = d[i];
+        }
+    }
+
+    // Compute the two leftmost points, where u and d are zero beyond the end
+    // and the ghost point is folded in through c.edge.
+    Real x0 = (p0 + c.edge) * uw[0] + p1 * uw[1] + p2 * uw[2] + q0 * dw[0] + q1 * dw[1];
+    Real x1 = p0 * uw[1] + p1 * (uw[0] + uw[2]) + p2 * uw[3] + q0 * dw[1] + q1 * (dw[0] + dw[2]);
+    d[0] = x0;
+    u[0] = uw[0] + x0;
+    d[1] = x1;
+    u[1] = uw[1] + x1;
+
+    // Compute inner points.
+    Real s = 0;
+
+    if (slope)
+        s = stiffStringIncrementInner<true>(p0, p1, p2, q0, q1, uw, dw, u, d, n);
+    else
+        stiffStringIncrementInner<false>(p0, p1, p2, q0, q1, uw, dw, u, d, n);
+
+    // Compute the two rightmost points, mirroring the left end.
+    Real xn2 = p0 * uw[n-2] + p1 * (uw[n-3] + uw[n-1]) + p2 * uw[n-4]
+        + q0 * dw[n-2] + q1 * (dw[n-3] + dw[n-1]);
+    Real xn1 = (p0 + c.edge) * uw[n-1] + p1 * uw[n-2] + p2 * uw[n-3]
+        + q0 * dw[n-1] + q1 * dw[n-2];
+    d[n-2] = xn2;
+    u[n-2] = uw[n-2] + xn2;
+    d[n-1] = xn1;
+    u[n-1] = uw[n-1] + xn1;
+
+    if (slope)
+    {
+        // Add the slopes at both ends, where the state is zero beyond them.
+        Real v[5] = {(Real)u[0], (Real)u[1], (Real)u[n-3], (Real)u[n-2], (Real)u[n-1]};
+        s += v[0] * v[0] + (v[1] - v[0]) * (v[1] - v[0])
+            + (v[3] - v[2]) * (v[3] - v[2]) + (v[4] - v[3]) * (v[4] - v[3]) + v[4] * v[4];
+    }
+
+    // A force moves both the state and the increment.
+    forces.apply(u, c.bf);
+    forces.apply(d, c.bf);
+
+    if (slope)
+        *slope = s + stiffStringForcedSlope(forces, u, n, c.bf);
+}
+
+/// Compute the next state of the inner points in a range of a string whose
+/// mass and stiffness vary, measuring the energy only if asked for.
+template <bool Energy, typename Real, typename Storage>
+inline void stiffStringVaryingInner(
+    const VaryingCoefficients<Real> &c,
+    const Storage *u,
+    const Storage *up,
+    Storage *un,
+    int lo,
+    int hi,
+    Real &e)
+{
+    const Real *a0 = c.a0.data();
+    const Real *l1 = c.l1.data();
+    const Real *r1 = c.r1.data();
+    const Real *l2 = c.l2.data();
+    const Real *r2 = c.r2.data();
+    Real b0 = c.b0;
+    Real b1 = c.b1;
+
+    for (int i = lo; i < hi; i++)
+    {
+        un[i] = a0[i] * u[i] + l1[i] * u[i-1] + r1[i] * u[i+1] + l2[i] * u[i-2] + r2[i] * u[i+2]
+            + b0 * up[i] + b1 * (up[i-1] + up[i+1]);
+
+        if (Energy)
+            e += stiffStringEnergyInner(c, u, up, i);
+    }
+}
+
+/// Compute the next state of the points in a range of a string whose mass and
+/// stiffness vary, without forces. The points beyond the ends have zero
+/// weight, so only the outermost two at either end need their reads kept
+/// inside the string, and the loop over the others is the same for every
+/// point and vectorizes.
+/// @param  c       The folded coefficients.
+/// @param  u       The current state.
+/// @param  up      The previous state.
+/// @param  un      Where to write the next state.
+/// @param  n       The number of points, must be at least 4.
+/// @param  lo      The first point of the range.
+/// @param  hi      One past the last point of the range.
+/// @param  energy  If not null, the energy of the range between the previous
+///                 and current state is added to it, from the same loads.
+template <typename Real, typename Storage>
+inline void stiffStringVaryingRange(
+    const VaryingCoefficients<Real> &c,
+    const Storage *u,
+    const Storage *up,
+    Storage *un,
+    int n,
+    int lo,
+    int hi,
+    Real *energy = nullptr)
+{
+    Real e = 0;
+
+    auto edge = [&](int i)
+    {
+        auto at = [&](const Storage *v, int j) { return j >= 0 && j < n ? (Real)v[j] : 0; };
+
+        un[i] = c.a0[i] * u[i] + c.l1[i] * at(u, i - 1) + c.r1[i] * at(u, i + 1)
+            + c.l2[i] * at(u, i - 2) + c.r2[i] * at(u, i + 2)
+            + c.b0 * up[i] + c.b1 * (at(up, i - 1) + at(up, i + 1));
+
+        if (energy)
+            e += stiffStringEnergy(c, u, up, i, n);
+    };
+
+    int i = lo;
+
+    for (; i < hi && i < 2; i++)
+        edge(i);
+
+    int end = hi < n - 2 ? hi : n - 2;
+
+    if (i < end)
+    {
+        if (energy)
+            stiffStringVaryingInner<true>(c, u, up, un, i, end, e);
+        else
+            stiffStringVaryingInner<false>(c, u, up, un, i, end, e);
+
+        i = end;
+    }
+
+    for (; i < hi; i++)
+        edge(i);
+
+    if (energy)
+        *energy += e;
+}
+
+/// Advance a string whose mass and stiffness vary one time step.
+/// @param  c       The folded coefficients.
+/// @param  u       The current state.
+/// @param  up      The previous state.
+/// @param  forces  The forces applied during the time step.
+/// @param  un      Where to write the next state.
+/// @param  n       The number of points, must be at least 4.
+/// @param  energy  If not null, set to the energy between the previous and
+///                 current state.
+template <typename Real, typename Storage>
+inline void stiffStringVaryingStep(
+    const VaryingCoefficients<Real> &c,
+    const Storage *u,
+    const Storage *up,
+    const SparseForces &forces,
+    Storage *un,
+    int n,
+    Real *energy = nullptr)
+{
+    if (energy)
+        *energy = 0;
+
+    stiffStringVaryingRange(c, u, up, un, n, 0, n, energy);
+    forces.applyWeighted(un, c.bf.data());
+}
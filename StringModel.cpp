@@ -0,0 +1,60 @@
+#include "StringModel.h"
+#include <algorithm>
+#include <cmath>
+
+float StringProfile::at(const std::vector<float> &factors, float x)
+{
+    if (factors.empty())
+        return 1;
+
+    if (factors.size() == 1)
+        return factors[0];
+
+    float t = std::min<float>(std::max<float>(x, 0), 1) * (factors.size() - 1);
+    int i = std::min<int>(t, factors.size() - 2);
+    return factors[i] + (t - i) * (factors[i+1] - factors[i]);
+}
+
+bool StringProfile::isUniform() const
+{
+    auto constant = [](const std::vector<float> &factors)
+    {
+        return std::all_of(factors.begin(), factors.end(), [&](float value) { return value == factors[0]; });
+    };
+
+    return constant(mass) && constant(stiffness);
+}
+
+StringParameters StringProfile::scale(const StringParameters &params) const
+{
+    float m = at(mass, 0);
+    float s = at(stiffness, 0);
+
+    StringParameters scaled = params;
+    scaled.gamma0 = params.gamma0 / m;
+    scaled.kappa0 = params.kappa0 * s / m;
+    return scaled;
+}
+
+int computeStableSize(const StringParameters &params, float sampleRate)
+{
+    float k = 1.0f / sampleRate;
+    float gamma0 = params.gamma0;
+    float kappa0 = params.kappa0;
+    float sigma1 = params.sigma1;
+    float hmin = sqrt(0.5 * (gamma0 * k * k + 4 * sigma1 * k + sqrt(powf(gamma0 * k * k + 4 * sigma1 * k, 2) + 16 * kappa0 * k * k)));
+    return floor(1 / hmin);
+}
+
+int computeStableSize(const StringParameters &params, const StringProfile &profile, float sampleRate)
+{
+    // Bound the string by a uniform one as light as its lightest part and as
+    // stiff as its stiffest.
+    float minMass = profile.mass.empty() ? 1 : *std::min_element(profile.mass.begin(), profile.mass.end());
+    float maxStiffness = profile.stiffness.empty() ? 1 : *std::max_element(profile.stiffness.begin(), profile.stiffness.end());
+
+    StringParameters bound = params;
+    bound.gamma0 = params.gamma0 / minMass;
+    bound.kappa0 = params.kappa0 * maxStiffness / minMass;
+    return computeStableSize(bound, sampleRate);
+}
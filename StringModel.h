@@ -0,0 +1,173 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+class ExcitationPoint;
+class Excitations;
+class Pickups;
+class StringTableCache;
+struct StringTables;
+
+/// The boundary conditions that can be imposed at both ends of a string.
+enum class BoundaryCondition
+{
+    SimplySupported,    // Fixed ends that are free to rotate (u = u_xx = 0).
+    Clamped             // Fixed ends that are not free to rotate (u = u_x = 0).
+};
+
+/// The number formats a string can compute in and store its state in.
+enum class Precision
+{
+    Float,      // Float state and arithmetic.
+    Double,     // Double state and arithmetic.
+    Mixed,      // Float state, double arithmetic.
+    Half,       // Half-precision state, float arithmetic.
+    BFloat16    // Bfloat16 state, float arithmetic.
+};
+
+/// The physical parameters of a stiff string.
+struct StringParameters
+{
+    // The model parameters
+    float gamma0 = 10000;   // The wave speed (pitch).
+    float kappa0 = 10;      // The stiffness (inharmonicity).
+    float sigma0 = 2;       // The independent damping (sustain).
+    float sigma1 = 1e-5;    // The dependent damping (brightness).
+};
+
+/// How the mass and bending stiffness of a string vary along it, such as for
+/// a string wound over part of its length or a tapered one. Each is given as
+/// factors of the uniform string at evenly spaced positions from one end to
+/// the other, linearly interpolated in between, and an empty list leaves it
+/// uniform. The tension is the same along the whole string, so a heavier
+/// part carries slower waves.
+struct StringProfile
+{
+    std::vector<float> mass;        // Factors of the mass per unit length.
+    std::vector<float> stiffness;   // Factors of the bending stiffness.
+
+    /// Get the factor of a list at a position.
+    /// @param  factors     The list of factors.
+    /// @param  x           The position as a fraction of the string length.
+    /// @returns            The interpolated factor, 1 if the list is empty.
+    static float at(const std::vector<float> &factors, float x);
+
+    /// Check whether the string is the same all along, in which case it is
+    /// a uniform string with scaled parameters.
+    bool isUniform() const;
+
+    /// Get the parameters of the uniform string with the mass and stiffness
+    /// of the first factors, which is the whole string if it is uniform.
+    /// @param  params  The parameters the factors apply to.
+    StringParameters scale(const StringParameters &params) const;
+};
+
+/// Compute the largest number of points a string can have while the scheme is
+/// still stable for a set of parameters.
+/// @param  params      The string parameters.
+/// @param  sampleRate  The sample rate the string runs at.
+/// @returns            The number of points.
+int computeStableSize(const StringParameters &params, float sampleRate = 44100);
+
+/// Compute the largest number of points a string whose mass and stiffness
+/// vary can have while the scheme is still stable, which is limited by its
+/// lightest and stiffest parts.
+/// @param  params      The string parameters.
+/// @param  profile     How the mass and stiffness vary.
+/// @param  sampleRate  The sample rate the string runs at.
+/// @returns            The number of points.
+int computeStableSize(const StringParameters &params, const StringProfile &profile, float sampleRate = 44100);
+
+/// The interface shared by all stiff string models, such that the dynamically
+/// sized string and its compile-time specializations can be used
+/// interchangeably.
+class StringModel
+{
+    public:
+    virtual ~StringModel() {}
+
+    /// Apply a force to the string.
+    /// @param  i       Where to apply the force.
+    /// @param  force   The magnitude of the force to apply.
+    virtual void applyForce(int i, float force) = 0;
+
+    /// Compute and apply the forces of all bows, plucks and strikes for the
+    /// coming time step.
+    virtual void computeForces() = 0;
+
+    /// Draw a UI for controlling the string.
+    virtual void draw(bool plot = true) = 0;
+
+    /// Excite the string by displacing a raised cosine.
+    virtual void excite() = 0;
+
+    /// Compute and get the next output sample.
+    /// @returns    The sum of all pickups.
+    virtual float getNext() = 0;
+
+    /// Compute the next time step and read all pickups into one frame.
+    /// @param  frame           Where to write the frame.
+    /// @param  numChannels     The number of channels in the frame.
+    virtual void getNext(float *frame, int numChannels) = 0;
+
+    /// Get the bows, plucks and strikes exciting the string.
+    virtual Excitations &getExcitations() = 0;
+
+    /// Get how far a force applied at a point with `applyForce`, spread by
+    /// the weights of the point, moves the point in the next time step.
+    /// @param  point   The point.
+    virtual float getForceGain(const ExcitationPoint &point) const = 0;
+
+    /// Get the numerical energy of the string, measured during the last time
+    /// step of the last block computed by `process`. Without excitation it
+    /// never grows, and with no damping it stays constant.
+    virtual float getEnergy() const = 0;
+
+    /// Get the parameters of the string.
+    virtual const StringParameters &getParameters() const = 0;
+
+    /// Get the pickups reading the string.
+    virtual Pickups &getPickups() = 0;
+
+    /// Get the number of points in the string.
+    virtual int getSize() const = 0;
+
+    /// Predict the value of the string at a point after the next time step,
+    /// from the forces applied so far.
+    /// @param  point   The point.
+    virtual float predict(const ExcitationPoint &point) const = 0;
+
+    /// Compute a block of output, running the string once per frame and
+    /// reading all pickups from that single pass.
+    /// @param  out             Where to write the interleaved output.
+    /// @param  numFrames       The number of frames to compute.
+    /// @param  numChannels     The number of channels per frame.
+    virtual void process(float *out, int numFrames, int numChannels) = 0;
+
+    /// Reset the string state to zero.
+    virtual void reset() = 0;
+
+    /// Set the force of the first bow.
+    /// @param  value   The desired bow force.
+    virtual void setBowForce(float value) = 0;
+
+    /// Set all parameters of the string at once.
+    /// @param  value   The desired parameters.
+    virtual void setParameters(const StringParameters &value) = 0;
+
+    /// Set the cache to share the coefficients of the string through, such
+    /// that strings with the same parameters keep a single copy. Strings
+    /// whose coefficients are only a handful of numbers keep their own.
+    /// @param  value   The cache.
+    virtual void setTableCache(const std::shared_ptr<StringTableCache> &value) = 0;
+
+    /// Set the parameters of the string from tables made off the audio
+    /// thread, for a string of the same size and sample rate.
+    /// @param  value   The tables.
+    virtual void setTables(const std::shared_ptr<const StringTables> &value) = 0;
+
+    /// Set the wave speed corresponding to a frequency.
+    /// @param  freq    The desired frequency.
+    virtual void setWavespeedFromFreq(float freq) = 0;
+};
@@ -0,0 +1,83 @@
+#include "StringTables.h"
+#include <algorithm>
+
+StringTables::StringTables(const StringParameters &params, const StringProfile &profile, int n, float k,
+    BoundaryCondition bc, const std::shared_ptr<const FretTable> &frets) :
+    params(params),
+    profile(profile),
+    n(n),
+    k(k),
+    boundary(bc),
+    frets(frets)
+{
+    // A string that is the same all along is a uniform one with scaled
+    // parameters. Otherwise the uniform coefficients are those of its left
+    // end, which the energy is measured with.
+    h = 1.0f / n;
+    scaled = profile.scale(params);
+    varying = !profile.isUniform();
+
+    coeffs.compute(scaled, k, h, bc);
+    coeffsDouble.compute(scaled, k, h, bc);
+
+    if (varying)
+    {
+        varyingCoeffs.compute(params, profile, k, h, bc, n);
+        varyingCoeffsDouble.compute(params, profile, k, h, bc, n);
+    }
+
+    // The largest wave speed the grid is stable for, from the same bound as
+    // computeStableSize.
+    double h2 = (double)h * h;
+    double gammaMax = (h2 - 4 * scaled.kappa0 * k * k / h2 - 4 * scaled.sigma1 * k) / ((double)k * k);
+    maxStretch = scaled.gamma0 > 0 ? std::max(0.0, gammaMax / scaled.gamma0 - 1) : 0;
+
+    if (!this->frets)
+        this->frets = std::make_shared<const FretTable>(scaled, k, n);
+}
+
+bool StringTables::matches(const StringParameters &params, const StringProfile &profile, int n, float k,
+    BoundaryCondition bc) const
+{
+    const StringParameters &p = this->params;
+
+    return n == this->n && k == this->k && bc == boundary
+        && params.gamma0 == p.gamma0 && params.kappa0 == p.kappa0
+        && params.sigma0 == p.sigma0 && params.sigma1 == p.sigma1
+        && profile.mass == this->profile.mass && profile.stiffness == this->profile.stiffness;
+}
+
+std::shared_ptr<const StringTables> StringTableCache::get(const StringParameters &params, const StringProfile &profile,
+    int n, float k, BoundaryCondition bc)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    StringParameters scaled = profile.scale(params);
+    std::shared_ptr<const FretTable> frets;
+
+    for (auto &cached : tables)
+    {
+        if (cached->matches(params, profile, n, k, bc))
+            return cached;
+
+        // The fret table only depends on the wave speed and stiffness.
+        if (cached->frets->matches(scaled, k, n))
+            frets = cached->frets;
+    }
+
+    // Free the tables only the cache holds on to.
+    if (tables.size() >= maxSize)
+    {
+        tables.erase(std::remove_if(tables.begin(), tables.end(),
+            [](const std::shared_ptr<const StringTables> &cached) { return cached.use_count() == 1; }),
+            tables.end());
+    }
+
+    tables.push_back(std::make_shared<const StringTables>(params, profile, n, k, bc, frets));
+    return tables.back();
+}
+
+int StringTableCache::getSize()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return tables.size();
+}
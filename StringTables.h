@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Excitation.h"
+#include "StringKernel.h"
+#include "StringModel.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// The coefficients of a stiff string, which only depend on its parameters,
+/// profile, size, sample period and boundary condition. They never change
+/// once made, so strings with the same parameters share one copy through a
+/// `StringTableCache`, and a running string can have a new copy swapped in
+/// from another thread.
+struct StringTables
+{
+    /// Fold parameters into coefficients.
+    /// @param  params      The parameters of the string.
+    /// @param  profile     How the mass and stiffness vary along the string.
+    /// @param  n           The number of points.
+    /// @param  k           The sample period.
+    /// @param  bc          The boundary condition at both ends.
+    /// @param  frets       The fret table of a string with the same wave
+    ///                     speed and stiffness, or null to make one.
+    StringTables(const StringParameters &params, const StringProfile &profile, int n, float k, BoundaryCondition bc,
+        const std::shared_ptr<const FretTable> &frets = nullptr);
+
+    /// Check whether the tables were made for a string.
+    /// @param  params      The parameters of the string.
+    /// @param  profile     How the mass and stiffness vary along the string.
+    /// @param  n           The number of points.
+    /// @param  k           The sample period.
+    /// @param  bc          The boundary condition at both ends.
+    bool matches(const StringParameters &params, const StringProfile &profile, int n, float k, BoundaryCondition bc) const;
+
+    /// Get the uniform coefficients in an arithmetic.
+    /// @tparam Real    The scalar type, `float` or `double`.
+    template <typename Real>
+    const StringCoefficients<Real> &getCoefficients() const;
+
+    StringParameters params;
+    StringProfile profile;
+    StringParameters scaled;        // The uniform string, or the left end of
+                                    // one that is not uniform.
+    int n = 0;
+    float k = 0;                    // Sample period.
+    float h = 0;                    // Grid spacing.
+    BoundaryCondition boundary;
+    bool varying = false;           // Whether the profile is not uniform.
+
+    StringCoefficients<float> coeffs;
+    StringCoefficients<double> coeffsDouble;
+
+    // The coefficients of every point, only if the string is not uniform.
+    VaryingCoefficients<float> varyingCoeffs;
+    VaryingCoefficients<double> varyingCoeffsDouble;
+
+    double maxStretch = 0;          // Largest relative increase of gamma0
+                                    // the grid is stable for.
+
+    // The pitch of the string stopped at each position, shared with the
+    // tables that only differ in damping, such as those of a released note.
+    std::shared_ptr<const FretTable> frets;
+};
+
+template <>
+inline const StringCoefficients<float> &StringTables::getCoefficients<float>() const
+{
+    return coeffs;
+}
+
+template <>
+inline const StringCoefficients<double> &StringTables::getCoefficients<double>() const
+{
+    return coeffsDouble;
+}
+
+/// Makes the tables of strings, handing the same tables to all strings with
+/// the same parameters, such as the voices of a pool playing the same note.
+/// Tables are made on the thread asking for them, which must not be the audio
+/// thread. The cache holds on to all tables it hands out, so a string
+/// dropping its tables on the audio thread never frees them there. Tables no
+/// string uses any more are freed once the cache is full.
+class StringTableCache
+{
+    public:
+    /// Get the tables of a string, making them if they are not cached.
+    /// @param  params      The parameters of the string.
+    /// @param  profile     How the mass and stiffness vary along the string.
+    /// @param  n           The number of points.
+    /// @param  k           The sample period.
+    /// @param  bc          The boundary condition at both ends.
+    std::shared_ptr<const StringTables> get(const StringParameters &params, const StringProfile &profile, int n,
+        float k, BoundaryCondition bc);
+
+    /// Get the number of cached tables.
+    int getSize();
+
+    static constexpr int maxSize = 64;
+
+    private:
+    std::vector<std::shared_ptr<const StringTables>> tables;
+    std::mutex mutex;
+};
@@ -0,0 +1,197 @@
+#include "SympatheticBank.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef PAL
+#include "pal/Gui.h"
+#endif
+
+SympatheticBank::SympatheticBank(float sampleRate) :
+    sampleRate(sampleRate),
+    mono(maxBlockSize)
+{
+}
+
+int SympatheticBank::addString(float frequency, const StringParameters &params, float coupling, float pan)
+{
+    BankString s;
+    s.first = a1.size();
+    s.coupling = coupling;
+    s.pan = pan;
+
+    float k = 1 / sampleRate;
+    float gamma = powf(2 * frequency, 2);
+
+    // Keep the modes below 0.45 times the sample rate, where the resonators
+    // are still well behaved.
+    int numModes = 0;
+
+    for (int m = 1; m <= maxModes; m++)
+    {
+        float beta = m * M_PI;
+        float omega = beta * sqrtf(gamma + params.kappa0 * beta * beta);
+
+        if (omega * k > 0.9 * M_PI)
+            break;
+
+        numModes = m;
+    }
+
+    s.count = (numModes + lanes - 1) / lanes * lanes;
+
+    for (int m = 1; m <= s.count; m++)
+    {
+        // Padding modes have no input and no output.
+        if (m > numModes)
+        {
+            a1.push_back(0);
+            a2.push_back(0);
+            b.push_back(0);
+            w.push_back(0);
+            continue;
+        }
+
+        // The mode q'' + 2 sigma q' + omega^2 q = phi(xb) f, with the poles
+        // of the continuous mode mapped exactly.
+        float beta = m * M_PI;
+        float omega = beta * sqrtf(gamma + params.kappa0 * beta * beta);
+        float sigma = params.sigma0 + params.sigma1 * beta * beta;
+        float r = expf(-sigma * k);
+        float omegad = sqrtf(std::max(0.0f, omega * omega - sigma * sigma));
+
+        a1.push_back(2 * r * cosf(omegad * k));
+        a2.push_back(r * r);
+        b.push_back(2 * k * k * sinf(beta * bridgePosition));
+        w.push_back(sinf(beta * pickupPosition));
+
+        // The gain of the mode at resonance.
+        float peak = fabsf(b.back() * w.back()) / ((1 - r) * std::max(sinf(omegad * k), 1e-3f));
+        s.sensitivity = std::max(s.sensitivity, peak);
+    }
+
+    y1.resize(a1.size(), 0);
+    y2.resize(a1.size(), 0);
+
+    strings.push_back(s);
+    return strings.size() - 1;
+}
+
+void SympatheticBank::draw()
+{
+#ifdef PAL
+    ImGui::SliderFloat("Sympathetic gain", &gain, 0, 10);
+    ImGui::Text("Sympathetic strings: %i of %i awake", getNumAwake(), getNumStrings());
+#endif
+}
+
+int SympatheticBank::getNumAwake() const
+{
+    return std::count_if(strings.begin(), strings.end(), [](const BankString &s) { return s.awake; });
+}
+
+void SympatheticBank::process(const float *bridge, float *out, int numFrames, int numChannels)
+{
+    std::fill(out, out + numFrames * numChannels, 0);
+
+    for (int frame = 0; frame < numFrames; frame += maxBlockSize)
+    {
+        int count = std::min(maxBlockSize, numFrames - frame);
+        float drive = 0;
+
+        for (int t = 0; t < count; t++)
+            drive = std::max(drive, fabsf(bridge[frame + t]));
+
+        for (auto &s : strings)
+        {
+            // Skip the string if it is silent and the drive is too weak to
+            // make it audible, clearing the state such that it never decays
+            // into denormals.
+            float level = 0;
+
+            for (int m = s.first; m < s.first + s.count; m++)
+                level = std::max(level, std::max(fabsf(y1[m]), fabsf(y2[m])));
+
+            if (level < silence && s.coupling * drive * s.sensitivity < silence)
+            {
+                std::fill(y1.begin() + s.first, y1.begin() + s.first + s.count, 0);
+                std::fill(y2.begin() + s.first, y2.begin() + s.first + s.count, 0);
+                s.awake = false;
+                continue;
+            }
+
+            s.awake = true;
+            run(s, bridge + frame, count);
+
+            float *dst = out + frame * numChannels;
+            float left = gain * fminf(1, 1 - s.pan);
+            float right = gain * fminf(1, 1 + s.pan);
+
+            for (int t = 0; t < count; t++)
+            {
+                if (numChannels == 1)
+                {
+                    dst[t] += gain * mono[t];
+                }
+                else
+                {
+                    dst[t * numChannels] += left * mono[t];
+                    dst[t * numChannels + 1] += right * mono[t];
+                }
+            }
+        }
+    }
+}
+
+void SympatheticBank::reset()
+{
+    std::fill(y1.begin(), y1.end(), 0);
+    std::fill(y2.begin(), y2.end(), 0);
+}
+
+void SympatheticBank::run(const BankString &s, const float *bridge, int numFrames)
+{
+    std::fill(mono.begin(), mono.begin() + numFrames, 0);
+
+    for (int first = s.first; first < s.first + s.count; first += lanes)
+    {
+        // Hold a group of modes in registers for the whole block.
+        float c1[lanes], c2[lanes], cb[lanes], cw[lanes], ya[lanes], yb[lanes];
+
+        for (int l = 0; l < lanes; l++)
+        {
+            c1[l] = a1[first + l];
+            c2[l] = a2[first + l];
+            cb[l] = s.coupling * b[first + l];
+            cw[l] = w[first + l];
+            ya[l] = y1[first + l];
+            yb[l] = y2[first + l];
+        }
+
+        for (int t = 0; t < numFrames; t++)
+        {
+            float f = bridge[t];
+            float y[lanes];
+
+            for (int l = 0; l < lanes; l++)
+            {
+                y[l] = c1[l] * ya[l] - c2[l] * yb[l] + cb[l] * f;
+                yb[l] = ya[l];
+                ya[l] = y[l];
+                y[l] *= cw[l];
+            }
+
+            float sum = 0;
+
+            for (int l = 0; l < lanes; l++)
+                sum += y[l];
+
+            mono[t] += sum;
+        }
+
+        for (int l = 0; l < lanes; l++)
+        {
+            y1[first + l] = ya[l];
+            y2[first + l] = yb[l];
+        }
+    }
+}
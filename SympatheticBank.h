@@ -0,0 +1,98 @@
+#pragma once
+
+#include "StringModel.h"
+#include <vector>
+
+/// A bank of undriven strings resonating in sympathy with the played ones,
+/// like the sympathetic strings of a sitar or the undamped strings of a piano.
+/// All strings pick up energy from a shared bridge, driven by the bridge
+/// force of the played strings.
+///
+/// The strings are modal rather than finite difference models: each mode is
+/// a damped two-pole resonator tuned to the exact frequency and decay of the
+/// corresponding mode of a stiff string. The modes of all strings are stored
+/// in flat arrays, padded per string to a multiple of `lanes`, such that the
+/// modes of a string are updated side by side in vector registers. A string
+/// whose state and drive are both negligible is skipped.
+class SympatheticBank
+{
+    public:
+    /// Create an empty bank.
+    /// @param  sampleRate  The sample rate to use (default 44100).
+    SympatheticBank(float sampleRate = 44100);
+
+    /// Add a string to the bank.
+    /// @param  frequency   The fundamental frequency.
+    /// @param  params      The stiffness and damping of the string. The wave
+    ///                     speed is set from the frequency.
+    /// @param  coupling    How strongly the string is driven by the bridge.
+    /// @param  pan         The stereo position from -1 (left) to 1 (right).
+    /// @returns            The index of the new string.
+    int addString(
+        float frequency,
+        const StringParameters &params = StringParameters(),
+        float coupling = 1,
+        float pan = 0);
+
+    /// Draw a UI for controlling the bank.
+    void draw();
+
+    /// Get the number of strings that were not skipped in the last block.
+    int getNumAwake() const;
+
+    /// Get the number of strings.
+    int getNumStrings() const { return strings.size(); };
+
+    /// Compute a block of the output of all strings.
+    /// @param  bridge          The force on the bridge for each frame.
+    /// @param  out             Where to write the interleaved output.
+    /// @param  numFrames       The number of frames to compute.
+    /// @param  numChannels     The number of channels per frame.
+    void process(const float *bridge, float *out, int numFrames, int numChannels);
+
+    /// Silence all strings.
+    void reset();
+
+    // The positions of strings added from now on, as fractions of their
+    // length.
+    float bridgePosition = 0.02;    // Where the strings touch the bridge.
+    float pickupPosition = 0.3;     // Where the strings are heard.
+
+    float gain = 1;                 // The gain of the output.
+    float silence = 1e-9;           // The amplitude below which a string is
+                                    // skipped.
+
+    static constexpr int lanes = 8;     // The number of modes updated at once.
+    static constexpr int maxModes = 32; // The most modes per string.
+
+    private:
+    struct BankString
+    {
+        int first = 0;          // The index of the first mode.
+        int count = 0;          // The number of modes, a multiple of `lanes`.
+        float coupling = 1;
+        float pan = 0;
+        float sensitivity = 0;  // The peak output per unit of steady drive.
+        bool awake = false;     // Whether the last block computed the string.
+    };
+
+    /// Run the modes of a string and write its output to `mono`.
+    /// @param  s           The string.
+    /// @param  bridge      The force on the bridge for each frame.
+    /// @param  numFrames   The number of frames.
+    void run(const BankString &s, const float *bridge, int numFrames);
+
+    float sampleRate = 44100;
+    std::vector<BankString> strings;
+
+    // The modes, y[n] = a1 y[n-1] - a2 y[n-2] + b f[n], heard with weight w.
+    std::vector<float> a1;
+    std::vector<float> a2;
+    std::vector<float> b;
+    std::vector<float> w;
+    std::vector<float> y1;
+    std::vector<float> y2;
+
+    static constexpr int maxBlockSize = 256;
+    std::vector<float> mono;    // The output of a single string.
+};
@@ -0,0 +1,387 @@
+#include "VoiceAllocator.h"
+#include "Excitation.h"
+#include "StringFactory.h"
+#include "WaveguideString.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef PAL
+#include "pal/Gui.h"
+#endif
+
+VoiceAllocator::VoiceAllocator(
+    int numVoices,
+    float maxFrequency,
+    const StringParameters &params,
+    float sampleRate,
+    int numWaveguides,
+    int maxChannels) :
+    voices(numVoices + numWaveguides),
+    status(new Status[numVoices + numWaveguides]),
+    params(params),
+    maxFrequency(maxFrequency),
+    sampleRate(sampleRate),
+    qualityLevel(0),
+    events(maxEvents),
+    scratch(maxBlockSize * std::max(maxChannels, 1))
+{
+    // A higher note needs a coarser grid, so a grid stable at the highest
+    // note is stable at all of them.
+    StringParameters highest = params;
+    highest.gamma0 = powf(2 * maxFrequency, 2);
+    gridSize = computeStableSize(highest, sampleRate);
+
+    // All voices have the same grid, so they can share their pluck profiles,
+    // and the voices playing the same note their coefficients.
+    // The waveguides place their plucks on the same grid, and their delay
+    // lines reach down to the lowest MIDI note.
+    profiles = std::make_shared<ProfileCache>();
+    tables = std::make_shared<StringTableCache>();
+    float minFrequency = 440 * powf(2, -69 / 12.0f);
+
+    for (int i = 0; i < voices.size(); i++)
+    {
+        Voice &voice = voices[i];
+        voice.waveguide = i >= numVoices;
+
+        if (voice.waveguide)
+            voice.string.reset(new WaveguideString(gridSize, sampleRate, minFrequency));
+        else
+            voice.string = makeStiffString(gridSize, params, BoundaryCondition::SimplySupported, Precision::Float, sampleRate);
+
+        voice.string->setTableCache(tables);
+        voice.string->setParameters(params);
+        voice.string->setBowForce(0);
+        voice.string->getExcitations().setProfileCache(profiles);
+
+        status[i].note = -1;
+        status[i].released = false;
+        status[i].energy = 0;
+    }
+}
+
+void VoiceAllocator::applyBudget()
+{
+    while (!fits(0, 0) && findVictim(false) >= 0)
+        sleep(voices[findVictim(false)]);
+}
+
+void VoiceAllocator::applyEvents()
+{
+    while (const Event *event = events.front())
+    {
+        switch (event->type)
+        {
+            case Event::NoteOn: startNote(*event); break;
+            case Event::NoteOff: releaseNote(*event); break;
+
+            case Event::Budget:
+                budget = event->budget;
+                applyBudget();
+                break;
+        }
+
+        events.pop();
+    }
+}
+
+void VoiceAllocator::draw()
+{
+#ifdef PAL
+    ImGui::Text("Voices: %i of %i active, quality level %i", getNumActive(), getNumVoices(), getQualityLevel());
+
+    VoiceBudget value = requestedBudget;
+
+    if (ImGui::SliderInt("Max. voices", &value.maxVoices, 1, getNumVoices()))
+        setBudget(value);
+
+    ImGui::Checkbox("Hammered", &hammered);
+
+    for (int i = 0; i < voices.size(); i++)
+    {
+        int note = status[i].note;
+
+        if (note >= 0)
+        {
+            ImGui::Text("%i: note %i%s%s, energy %g", i, note, voices[i].waveguide ? " (waveguide)" : "",
+                status[i].released ? " (released)" : "", status[i].energy.load());
+        }
+    }
+#endif
+}
+
+int VoiceAllocator::findSleeping(bool waveguide) const
+{
+    for (int i = 0; i < voices.size(); i++)
+    {
+        if (!voices[i].isActive() && voices[i].waveguide == waveguide)
+            return i;
+    }
+
+    return -1;
+}
+
+int VoiceAllocator::findVictim(bool waveguide) const
+{
+    int victim = -1;
+
+    for (int i = 0; i < voices.size(); i++)
+    {
+        const Voice &voice = voices[i];
+
+        if (!voice.isActive() || voice.waveguide != waveguide)
+            continue;
+
+        if (victim < 0)
+        {
+            victim = i;
+            continue;
+        }
+
+        // Released notes go first, then the quietest, then the oldest.
+        const Voice &other = voices[victim];
+        float energy = voice.string->getEnergy();
+        float otherEnergy = other.string->getEnergy();
+
+        if (voice.released != other.released)
+        {
+            if (voice.released)
+                victim = i;
+        }
+        else if (energy != otherEnergy)
+        {
+            if (energy < otherEnergy)
+                victim = i;
+        }
+        else if (voice.age < other.age)
+        {
+            victim = i;
+        }
+    }
+
+    return victim;
+}
+
+bool VoiceAllocator::fits(int numVoices, int numPoints) const
+{
+    int active = numVoices;
+    int points = numPoints;
+
+    for (const auto &voice : voices)
+    {
+        if (voice.isActive() && !voice.waveguide)
+        {
+            active++;
+            points += voice.string->getSize();
+        }
+    }
+
+    // Lower quality levels never reduce the budget below a single voice.
+    int maxVoices = std::max(1, budget.maxVoices >> qualityLevel);
+    int maxPoints = budget.maxPoints >> qualityLevel;
+
+    return active <= maxVoices
+        && (points <= maxPoints || (active <= 1 && points <= budget.maxPoints));
+}
+
+int VoiceAllocator::getNumActive() const
+{
+    int active = 0;
+
+    for (int i = 0; i < voices.size(); i++)
+        active += status[i].note >= 0;
+
+    return active;
+}
+
+std::shared_ptr<const StringTables> VoiceAllocator::getTables(int note, bool released)
+{
+    StringParameters p = params;
+    float freq = std::min(maxFrequency, 440 * powf(2, (note - 69) / 12.0f));
+    p.gamma0 = powf(2 * freq, 2);
+
+    if (released)
+        p.sigma0 = std::max(p.sigma0, releaseSigma0);
+
+    return tables->get(p, StringProfile(), gridSize, 1.0f / sampleRate, BoundaryCondition::SimplySupported);
+}
+
+bool VoiceAllocator::noteOff(int note)
+{
+    Event event;
+    event.type = Event::NoteOff;
+    event.note = note;
+    event.tables = getTables(note, true);
+    return events.push(event);
+}
+
+bool VoiceAllocator::noteOn(int note, float velocity)
+{
+    Event event;
+    event.type = Event::NoteOn;
+    event.note = note;
+    event.hammered = hammered;
+    event.pluckForce = velocity * pluckForce;
+    event.pluckProfile = profiles->getProfile(gridSize, pluckPosition, pluckWidth, Interpolation::Linear);
+    event.pluckEnvelope = profiles->getEnvelope(Envelope::Ramp, std::max(1, (int)(0.005 * sampleRate)));
+    event.hammerPosition = hammerPosition;
+    event.hammerVelocity = velocity * hammerVelocity;
+    event.tables = getTables(note, false);
+    return events.push(event);
+}
+
+
+void VoiceAllocator::process(float *out, int numFrames, int numChannels)
+{
+    applyEvents();
+    std::fill(out, out + numFrames * numChannels, 0);
+
+    int blockSize = std::max<int>(scratch.size() / numChannels, 1);
+
+    float threshold = sleepLevel * powf(100, qualityLevel);
+
+    for (auto &voice : voices)
+    {
+        if (!voice.isActive())
+            continue;
+
+        for (int frame = 0; frame < numFrames; frame += blockSize)
+        {
+            int count = std::min(blockSize, numFrames - frame);
+            voice.string->process(scratch.data(), count, numChannels);
+
+            float *dst = out + frame * numChannels;
+
+            for (int i = 0; i < count * numChannels; i++)
+                dst[i] += scratch[i];
+        }
+
+        // Sleep once the energy has decayed, but never while the voice is
+        // still being excited, as a pluck starts from silence.
+        float energy = voice.string->getEnergy();
+        voice.peak = std::max(voice.peak, energy);
+
+        if (!voice.string->getExcitations().isActive() && energy <= threshold * voice.peak)
+            sleep(voice);
+    }
+
+    for (int i = 0; i < voices.size(); i++)
+    {
+        status[i].note = voices[i].note;
+        status[i].released = voices[i].released;
+        status[i].energy = voices[i].isActive() ? voices[i].string->getEnergy() : 0;
+    }
+}
+
+void VoiceAllocator::releaseNote(const Event &event)
+{
+    for (auto &voice : voices)
+    {
+        if (voice.note == event.note && !voice.released)
+        {
+            voice.string->setTables(event.tables);
+            voice.released = true;
+        }
+    }
+}
+
+bool VoiceAllocator::setBudget(const VoiceBudget &value)
+{
+    Event event;
+    event.type = Event::Budget;
+    event.budget = value;
+    requestedBudget = value;
+    return events.push(event);
+}
+
+void VoiceAllocator::setKernel(const KernelChoice &kernel)
+{
+    for (Voice &voice : voices)
+    {
+        if (voice.waveguide)
+            continue;
+
+        voice.string = makeStiffString(gridSize, kernel, params, BoundaryCondition::SimplySupported, sampleRate);
+        voice.string->setTableCache(tables);
+        voice.string->setBowForce(0);
+        voice.string->getExcitations().setProfileCache(profiles);
+        sleep(voice);
+    }
+}
+
+void VoiceAllocator::setQualityLevel(int value)
+{
+    qualityLevel = std::min(std::max(value, 0), maxQualityLevel);
+    applyBudget();
+}
+
+void VoiceAllocator::sleep(Voice &voice)
+{
+    voice.string->reset();
+    voice.note = -1;
+    voice.released = false;
+    voice.peak = 0;
+}
+
+void VoiceAllocator::startNote(const Event &event)
+{
+    if (voices.empty())
+        return;
+
+    // Retrigger a voice still playing the same note.
+    int v = -1;
+
+    for (int i = 0; i < voices.size() && v < 0; i++)
+    {
+        if (voices[i].note == event.note)
+            v = i;
+    }
+
+    if (v < 0 && fits(1, gridSize))
+        v = findSleeping(false);
+
+    // A note that finds no room among the finite difference strings goes to
+    // a waveguide string before any voice is stolen.
+    if (v < 0)
+        v = findSleeping(true);
+
+    if (v < 0)
+    {
+        // Steal until one more voice fits the budget.
+        while (!fits(1, gridSize))
+        {
+            int victim = findVictim(false);
+
+            if (victim < 0)
+                return;
+
+            sleep(voices[victim]);
+        }
+
+        v = findSleeping(false);
+
+        // The pool itself is exhausted.
+        if (v < 0)
+        {
+            v = findVictim(false);
+
+            if (v < 0)
+                v = findVictim(true);
+
+            sleep(voices[v]);
+        }
+    }
+
+    Voice &voice = voices[v];
+    voice.string->setTables(event.tables);
+
+    if (event.hammered && !voice.waveguide)
+        voice.string->getExcitations().hammer(event.hammerPosition, event.hammerVelocity);
+    else
+        voice.string->getExcitations().prescribe(event.pluckProfile, event.pluckEnvelope, event.pluckForce);
+
+    voice.note = event.note;
+    voice.released = false;
+    voice.peak = 0;
+    voice.age = notes++;
+}
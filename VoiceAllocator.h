@@ -0,0 +1,236 @@
+#pragma once
+
+#include "EventQueue.h"
+#include "StringFactory.h"
+#include "StringModel.h"
+#include "StringTables.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/// Limits on the work done by the active voices, such that the load stays
+/// bounded however dense the input.
+struct VoiceBudget
+{
+    int maxVoices = 16;         // The most voices active at once.
+    int maxPoints = 1 << 16;    // The most grid points in all active voices.
+};
+
+/// A string voice in the pool of a `VoiceAllocator`.
+struct Voice
+{
+    std::unique_ptr<StringModel> string;
+    int note = -1;          // The MIDI note playing, or -1 when asleep.
+    bool released = false;  // Whether the note has been released.
+    float peak = 0;         // The highest energy since the note started.
+    long age = 0;           // When the note started, in notes.
+    bool waveguide = false; // Whether the voice is a waveguide string, which
+                            // the budget does not count.
+
+    bool isActive() const { return note >= 0; };
+};
+
+/// Plays notes on a fixed, preallocated pool of strings. A note goes to a
+/// sleeping voice if there is one and the budget allows, and otherwise steals
+/// the quietest active voice, preferring released notes over held ones. Voices
+/// fall asleep once their energy has decayed, and asleep they cost nothing.
+///
+/// The pool can have a cheap tier of waveguide strings, which take the notes
+/// that find no room among the finite difference strings before any voice is
+/// stolen. They cost a fraction of a finite difference string, so the budget
+/// does not count them, and are always plucked.
+///
+/// The pool is owned by the audio thread, which calls `process` and
+/// `setQualityLevel`. Another thread, such as the GUI or MIDI thread, calls
+/// `noteOn`, `noteOff` and `setBudget`, which only queue events on a lock-free
+/// FIFO. `process` applies them before computing the block, so the voices are
+/// only ever touched by the audio thread. The coefficients and pluck profile
+/// of a note are found when the note is queued, so starting it allocates
+/// nothing.
+class VoiceAllocator
+{
+    public:
+    /// Create the pool of voices.
+    /// @param  numVoices       The number of voices in the pool.
+    /// @param  maxFrequency    The highest frequency any voice is stable at,
+    ///                         which determines the grid size of all voices.
+    /// @param  params          The parameters of the strings, except the wave
+    ///                         speed, which is set by each note.
+    /// @param  sampleRate      The sample rate to use (default 44100).
+    /// @param  numWaveguides   The number of waveguide strings in the pool,
+    ///                         in addition to the finite difference ones.
+    /// @param  maxChannels     The most channels per frame `process` is
+    ///                         called with (default 2).
+    VoiceAllocator(
+        int numVoices,
+        float maxFrequency,
+        const StringParameters &params = StringParameters(),
+        float sampleRate = 44100,
+        int numWaveguides = 0,
+        int maxChannels = 2);
+
+    /// Draw a UI showing the voices and controlling the budget, as of the
+    /// last block computed.
+    void draw();
+
+    /// Get the budget last set.
+    const VoiceBudget &getBudget() const { return requestedBudget; };
+
+    /// Get the quality level.
+    int getQualityLevel() const { return qualityLevel; };
+
+    /// Get the number of points of the finite difference strings.
+    int getGridSize() const { return gridSize; };
+
+    /// Get the number of voices active after the last block computed.
+    int getNumActive() const;
+
+    /// Get the number of voices in the pool.
+    int getNumVoices() const { return voices.size(); };
+
+    /// Get a voice, such as to set up its pickups before the audio starts.
+    /// @param  i   The index of the voice.
+    Voice &getVoice(int i) { return voices[i]; };
+
+    /// Queue the release of a note, which lets it ring out with the release
+    /// damping.
+    /// @param  note    The MIDI note to release.
+    /// @returns        False if the queue is full and the event was dropped.
+    bool noteOff(int note);
+
+    /// Queue the start of a note, which steals a voice if the pool or budget
+    /// is exhausted. How the note is excited is taken from the settings at
+    /// the time it is queued.
+    /// @param  note        The MIDI note.
+    /// @param  velocity    The velocity from 0 to 1, which scales the pluck
+    ///                     force or the hammer velocity.
+    /// @returns            False if the queue is full and the event was
+    ///                     dropped.
+    bool noteOn(int note, float velocity);
+
+    /// Apply the queued events and compute a block of the mix of all active
+    /// voices. More channels than the pool was made for are computed in
+    /// shorter runs, rather than allocating on the audio thread.
+    /// @param  out             Where to write the interleaved output.
+    /// @param  numFrames       The number of frames to compute.
+    /// @param  numChannels     The number of channels per frame.
+    void process(float *out, int numFrames, int numChannels);
+
+    /// Queue a new budget of the active voices, which steals voices until the
+    /// active ones fit.
+    /// @param  value   The budget.
+    /// @returns        False if the queue is full and the event was dropped.
+    bool setBudget(const VoiceBudget &value);
+
+    /// Set the kernel the finite difference strings run on, such as the one
+    /// `KernelTuner` chooses for the grid size. This recreates the strings,
+    /// silencing them and resetting their pickups, so it is meant to be
+    /// called while setting up, off the audio thread.
+    /// @param  kernel  The kernel.
+    void setKernel(const KernelChoice &kernel);
+
+    /// Set the quality level, trading fidelity for load. Each level above 0
+    /// halves the budget and puts voices to sleep 20 dB sooner, which cuts
+    /// the quiet tails first. Voices are stolen until the active ones fit, so
+    /// this must be called from the audio thread.
+    /// @param  value   The level, from 0 (full quality) to `maxQualityLevel`.
+    void setQualityLevel(int value);
+
+    static constexpr int maxQualityLevel = 3;
+    static constexpr int maxEvents = 256;   // The capacity of the queue.
+
+    float pluckPosition = 0.2;  // Where notes pluck, as a fraction of the length.
+    float pluckForce = 10;      // The pluck force at full velocity.
+    float pluckWidth = 0.02;    // The width of the finger, as a fraction of
+                                // the length.
+    bool hammered = false;      // Whether notes are struck by a piano hammer
+                                // rather than plucked.
+    float hammerPosition = 0.12;    // Where hammers strike.
+    float hammerVelocity = 0.02;    // The hammer velocity at full velocity.
+    float releaseSigma0 = 20;   // The independent damping after note off.
+    float sleepLevel = 1e-6;    // The energy relative to the peak at which a
+                                // voice falls asleep, 1e-6 being -60 dB.
+
+    private:
+    /// An event queued for the audio thread.
+    struct Event
+    {
+        enum Type { NoteOn, NoteOff, Budget };
+
+        Type type = NoteOn;
+        int note = -1;
+        bool hammered = false;  // Whether a note is struck rather than plucked.
+        float pluckForce = 0;   // Scaled by the velocity.
+        std::shared_ptr<const SpatialProfile> pluckProfile;
+        std::shared_ptr<const std::vector<float>> pluckEnvelope;
+        float hammerPosition = 0;
+        float hammerVelocity = 0;   // Scaled by the velocity.
+        VoiceBudget budget;
+        std::shared_ptr<const StringTables> tables; // The coefficients of the
+                                                    // note, held or released.
+    };
+
+    /// What `draw` shows of a voice, as of the last block computed.
+    struct Status
+    {
+        std::atomic<int> note;
+        std::atomic<bool> released;
+        std::atomic<float> energy;
+    };
+
+    /// Apply the queued events, on the audio thread.
+    void applyEvents();
+
+    /// Steal voices until the active ones fit the budget.
+    void applyBudget();
+
+    /// Find a sleeping voice.
+    /// @param  waveguide   Whether to look among the waveguide strings.
+    /// @returns            The index of the voice, or -1 if all are active.
+    int findSleeping(bool waveguide) const;
+
+    /// Choose the voice to steal, the quietest active one.
+    /// @param  waveguide   Whether to look among the waveguide strings.
+    /// @returns            The index of the voice, or -1 if none is active.
+    int findVictim(bool waveguide) const;
+
+    /// Get the coefficients of a note from the cache.
+    /// @param  note        The MIDI note.
+    /// @param  released    Whether to get them with the release damping.
+    std::shared_ptr<const StringTables> getTables(int note, bool released);
+
+    /// Release a note, on the audio thread.
+    /// @param  event   The note off event.
+    void releaseNote(const Event &event);
+
+    /// Put a voice to sleep, silencing it at once.
+    /// @param  voice   The voice.
+    void sleep(Voice &voice);
+
+    /// Check whether the active voices and some more fit the budget.
+    /// @param  numVoices   The number of voices to add.
+    /// @param  numPoints   The number of points in the voices to add.
+    bool fits(int numVoices, int numPoints) const;
+
+    /// Start a note, on the audio thread.
+    /// @param  event   The note on event.
+    void startNote(const Event &event);
+
+    std::vector<Voice> voices;
+    std::unique_ptr<Status[]> status;
+    VoiceBudget budget;             // The budget applied on the audio thread.
+    VoiceBudget requestedBudget;    // The budget last queued.
+    StringParameters params;
+    std::shared_ptr<ProfileCache> profiles;    // The pluck profiles of the grid.
+    std::shared_ptr<StringTableCache> tables;  // The coefficients of each note.
+    float maxFrequency = 0;
+    float sampleRate = 44100;
+    int gridSize = 0;           // The points of a finite difference string.
+    long notes = 0;             // The number of notes started.
+    std::atomic<int> qualityLevel;
+
+    EventQueue<Event> events;   // From the thread playing the notes.
+
+    static constexpr int maxBlockSize = 256;
+    std::vector<float> scratch; // The output of a single voice.
+};
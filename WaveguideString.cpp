@@ -0,0 +1,406 @@
+#include "WaveguideString.h"
+#include "StringTables.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+#ifdef PAL
+#include "pal/Gui.h"
+#endif
+
+// Get the phase delay in samples of the first-order all pass
+// (a + z^-1) / (1 + a z^-1) at a frequency in radians per sample.
+static double allpassDelay(double a, double w)
+{
+    std::complex<double> z = std::polar(1.0, -w);
+    return -std::arg((a + z) / (1.0 + a * z)) / w;
+}
+
+// Get the phase delay in samples of the one-pole filter 1 / (1 - p z^-1).
+static double lossDelay(double p, double w)
+{
+    return atan2(p * sin(w), 1 - p * cos(w)) / w;
+}
+
+// Add a value to a delay line at a fractional tap, with linear weights.
+static void addAt(pal::Delay &line, float tap, float value)
+{
+    int i = floor(tap);
+    float t = tap - i;
+
+    line.writeAt(line.readAt(i) + (1 - t) * value, i);
+
+    if (t > 0)
+        line.writeAt(line.readAt(i + 1) + t * value, i + 1);
+}
+
+WaveguideString::WaveguideString(int n, float sampleRate, float minFrequency) :
+    right(ceil(sampleRate / (2 * minFrequency)) + 2),
+    left(ceil(sampleRate / (2 * minFrequency)) + 2),
+    excitations(n, sampleRate),
+    pickups(n),
+    n(n)
+{
+    k = 1.0f / sampleRate;
+    h = 1.0f / n;
+    leak = exp(-2 * M_PI * k);
+
+    excitations.addBow();
+    pickups.add(0.6);
+    design();
+}
+
+void WaveguideString::applyForce(int i, float force)
+{
+    f.add(i, (1 / h) * force);
+}
+
+void WaveguideString::computeForces()
+{
+    excitations.applyPrescribed(f, h);
+
+    for (int i = 0; i < excitations.getNumBows(); i++)
+    {
+        Bow &bow = excitations.getBow(i);
+
+        if (bow.fb == 0)
+            continue;
+
+        // The bow force sends F / 2c into both waves, so the string under the
+        // bow moves at the velocity the waves arrive with plus F / 2c.
+        float c0 = velocityAt(bow.point.getPosition()) - bow.vb;
+        float c1 = bow.fb / (2 * c);
+
+        bow.friction.setModel(bow.model);
+        bow.friction.setCharacteristic(bow.a);
+        float force = -bow.fb * bow.friction.solve(c0, c1, c0);
+        bow.point.spread(f, (1 / h) * force);
+    }
+}
+
+void WaveguideString::design()
+{
+    c = sqrt(std::max(params.gamma0, 1e-6f));
+
+    // The partials of a stiff string of unit length with simply supported
+    // ends, and the delay around the loop each needs, in samples.
+    auto omega = [&](int m)
+    {
+        double beta = m * M_PI;
+        return k * sqrt(params.gamma0 * beta * beta + params.kappa0 * beta * beta * beta * beta);
+    };
+
+    auto decay = [&](int m)
+    {
+        double beta = m * M_PI;
+        return params.sigma0 + params.sigma1 * beta * beta;
+    };
+
+    double w1 = std::min(omega(1), 0.9 * M_PI);
+    double period = 2 * M_PI / w1;
+
+    // Fit the all pass sections to the stretching of the first eight
+    // partials below a quarter of the sample rate, relative to the
+    // fundamental, as long as they leave room for the delay lines at the
+    // fundamental. Fitting higher partials costs the lower ones, which
+    // matter more.
+    double a = 0;
+    numSections = params.kappa0 > 0 && 2 * dispersionSections + 3 < period ? dispersionSections : 0;
+
+    if (numSections > 0)
+    {
+        int orders = 2 * numSections;
+        double lo = -0.99;
+        double hi = 0;
+
+        for (int i = 0; i < 40; i++)
+        {
+            double mid = (lo + hi) / 2;
+
+            if (orders * allpassDelay(mid, w1) > period - 3)
+                lo = mid;
+            else
+                hi = mid;
+        }
+
+        double amin = hi;
+
+        auto error = [&](double a)
+        {
+            double e = 0;
+            double base = orders * allpassDelay(a, w1);
+
+            for (int m = 2; m <= 8 && omega(m) < M_PI / 2; m++)
+            {
+                double target = 2 * M_PI * m / omega(m) - period;
+                double d = orders * allpassDelay(a, omega(m)) - base - target;
+                e += d * d;
+            }
+
+            return e;
+        };
+
+        // Golden section search, the error having a single minimum.
+        double ratio = (sqrt(5.0) - 1) / 2;
+        lo = amin;
+        hi = 0;
+
+        for (int i = 0; i < 40; i++)
+        {
+            double x1 = hi - ratio * (hi - lo);
+            double x2 = lo + ratio * (hi - lo);
+
+            if (error(x1) < error(x2))
+                hi = x2;
+            else
+                lo = x1;
+        }
+
+        a = (lo + hi) / 2;
+    }
+
+    // Match the loss filter to the decay per trip around the loop of the
+    // fundamental and of the highest partial below an eighth of the sample
+    // rate, which fixes the pole and the gain.
+    double g1 = exp(-decay(1) * period * k);
+    double p = 0;
+    int r = 1;
+
+    while (r < 64 && omega(r + 1) < M_PI / 4)
+        r++;
+
+    if (r > 1)
+    {
+        double wr = omega(r);
+        double gr = exp(-decay(r) * (2 * M_PI * r / wr) * k);
+        double ratio = (gr / g1) * (gr / g1);
+        double b = cos(w1) - ratio * cos(wr);
+        double disc = b * b - (1 - ratio) * (1 - ratio);
+
+        if (ratio < 1 && disc >= 0)
+            p = std::min((b - sqrt(disc)) / (1 - ratio), 0.95);
+    }
+
+    double g0 = std::min(g1 * std::abs(1.0 - p * std::polar(1.0, -w1)) / (1 - p), 1.0);
+
+    // Tune the loop to the fundamental, with an integer delay split between
+    // the lines and a first-order Thiran all pass for the rest.
+    double rest = period - 2 * numSections * allpassDelay(a, w1) - lossDelay(p, w1);
+    int total = std::min<int>(std::max<int>(floor(rest - 0.5), 2), 2 * right.getLength());
+    double delta = std::min(std::max(rest - total, 0.5), 1.5);
+    double d = delta;
+    double eta = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        eta = (1 - d) / (1 + d);
+        d += delta - allpassDelay(eta, w1);
+    }
+
+    rightLength = total / 2;
+    leftLength = total - rightLength;
+
+    double actual = total + allpassDelay(eta, w1) + 2 * numSections * allpassDelay(a, w1) + lossDelay(p, w1);
+    frequency = w1 / (2 * M_PI * k) * period / actual;
+
+    double b0 = g0 * (1 - p);
+    loop.setCoefficients(b0 * eta, b0, 0, eta - p, -p * eta);
+
+    for (int i = 0; i < numSections; i++)
+        dispersion[i].setCoefficients(a * a, 2 * a, 1, 2 * a, a * a);
+}
+
+float WaveguideString::displacementAt(float x) const
+{
+    float y = 0;
+    int last = std::min<int>(x * rightLength, rightLength);
+    int first = std::max<int>(ceil((1 - x) * leftLength), 0);
+
+    for (int t = 0; t < last; t++)
+        y -= (1.0f / rightLength) * right.readAt(t);
+
+    for (int t = first; t < leftLength; t++)
+        y += (1.0f / leftLength) * left.readAt(t);
+
+    return y / c;
+}
+
+void WaveguideString::draw(bool plot)
+{
+#ifdef PAL
+    excitations.draw();
+    pickups.draw();
+
+    ImGui::Text("Waveguide: %i samples, %.2f Hz, %i dispersion sections", rightLength + leftLength,
+        frequency, numSections);
+    ImGui::Text("Energy: %g", energy);
+#endif
+}
+
+void WaveguideString::excite()
+{
+    // Displace a raised cosine peaking at one. Released at rest, half of it
+    // travels either way, as the velocity waves -c/2 y0' and c/2 y0'.
+    auto shape = [](float x) { return fabsf(x - 0.3f) < 0.05f ? 0.5f * (1 + cosf(20 * M_PI * (x - 0.3f))) : 0; };
+    auto slope = [](float x) { return fabsf(x - 0.3f) < 0.05f ? -10 * M_PI * sinf(20 * M_PI * (x - 0.3f)) : 0; };
+
+    for (int t = 0; t < rightLength; t++)
+        right.writeAt(right.readAt(t) - 0.5f * c * slope((float)t / rightLength), t);
+
+    for (int t = 0; t < leftLength; t++)
+        left.writeAt(left.readAt(t) + 0.5f * c * slope(1 - (float)t / leftLength), t);
+
+    for (int i = 0; i < pickups.size(); i++)
+        pickups.get(i).displacement += shape(pickups.get(i).point.getPosition());
+}
+
+float WaveguideString::getForceGain(const ExcitationPoint &point) const
+{
+    return k / (2 * c) * point.norm;
+}
+
+float WaveguideString::getNext()
+{
+    float y = 0;
+    step(&y, 1);
+    return y;
+}
+
+void WaveguideString::getNext(float *frame, int numChannels)
+{
+    step(frame, numChannels);
+}
+
+void WaveguideString::inject(float x, float dv)
+{
+    addAt(right, std::min<float>(std::max<float>(x * rightLength, 0), rightLength - 1), dv);
+    addAt(left, std::min<float>(std::max<float>((1 - x) * leftLength, 0), leftLength - 1), dv);
+}
+
+float WaveguideString::predict(const ExcitationPoint &point) const
+{
+    float x = point.getPosition();
+    return displacementAt(x) + k * velocityAt(x);
+}
+
+void WaveguideString::process(float *out, int numFrames, int numChannels)
+{
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        computeForces();
+        step(out + frame * numChannels, numChannels);
+    }
+
+    // Each wave carries kinetic and potential energy in equal parts.
+    float e = 0;
+
+    for (int t = 0; t < rightLength; t++)
+        e += (1.0f / rightLength) * right.readAt(t) * right.readAt(t);
+
+    for (int t = 0; t < leftLength; t++)
+        e += (1.0f / leftLength) * left.readAt(t) * left.readAt(t);
+
+    energy = e;
+
+    // Bring a silent string to rest, such that the waves and filters never
+    // decay into denormals.
+    if (energy < silence && !excitations.isActive())
+        reset();
+}
+
+void WaveguideString::propagate()
+{
+    right.proceed();
+    left.proceed();
+
+    float nut = right.readAt(rightLength);
+    float bridge = loop.process(left.readAt(leftLength));
+
+    for (int i = 0; i < numSections; i++)
+        bridge = dispersion[i].process(bridge);
+
+    right.write(-bridge);
+    left.write(-nut);
+}
+
+void WaveguideString::reset()
+{
+    for (int t = 0; t <= right.getLength(); t++)
+    {
+        right.writeAt(0, t);
+        left.writeAt(0, t);
+    }
+
+    loop.reset();
+
+    for (auto &section : dispersion)
+        section.reset();
+
+    for (int i = 0; i < pickups.size(); i++)
+        pickups.get(i).displacement = 0;
+
+    f.clear();
+    excitations.reset();
+    energy = 0;
+}
+
+void WaveguideString::setBowForce(float value)
+{
+    if (excitations.getNumBows() > 0)
+    {
+        excitations.getBow(0).fb = value;
+    }
+}
+
+void WaveguideString::setParameters(const StringParameters &value)
+{
+    params = value;
+    design();
+}
+
+void WaveguideString::setTables(const std::shared_ptr<const StringTables> &value)
+{
+    setParameters(value->params);
+}
+
+void WaveguideString::setWavespeedFromFreq(float freq)
+{
+    params.gamma0 = powf(2 * freq, 2);
+    design();
+}
+
+void WaveguideString::step(float *frame, int numChannels)
+{
+    // A point force F sends F / 2c into both waves.
+    for (int j = 0; j < f.size(); j++)
+        inject(f.index(j) * h, (h / (2 * c)) * f.value(j));
+
+    f.clear();
+    propagate();
+
+    for (int channel = 0; channel < numChannels; channel++)
+        frame[channel] = 0;
+
+    for (int i = 0; i < pickups.size(); i++)
+    {
+        Pickup &pickup = pickups.get(i);
+        float v = velocityAt(pickup.point.getPosition());
+        float y = v;
+
+        pickup.displacement = leak * pickup.displacement + k * v;
+
+        if (pickup.output == PickupOutput::Displacement)
+            y = pickup.displacement;
+        else if (pickup.output == PickupOutput::BridgeForce)
+            y = c * (left.readAt(leftLength - 1) - right.readAt(0));
+
+        Pickups::mix(pickup, y, frame, numChannels);
+    }
+}
+
+float WaveguideString::velocityAt(float x) const
+{
+    float tr = std::min<float>(std::max<float>(x * rightLength, 0), rightLength - 1);
+    float tl = std::min<float>(std::max<float>((1 - x) * leftLength, 0), leftLength - 1);
+    return right.readFractional(tr) + left.readFractional(tl);
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "Excitation.h"
+#include "Pickup.h"
+#include "StringKernel.h"
+#include "StringModel.h"
+#include "pal/Filter.h"
+#include "pal/delay.h"
+#include <vector>
+
+/// A digital waveguide string: a far cheaper stand-in for `StiffString` with
+/// the same parameters, whose cost does not depend on its pitch.
+///
+/// The string is two delay lines of velocity waves travelling in opposite
+/// directions, inverted at both fixed ends. The losses, the inharmonicity and
+/// the fractional part of the delay are lumped into filters at the bridge end:
+/// a one-pole loss filter matching the decay of the fundamental and of a
+/// higher partial, a cascade of all pass filters fitted to the stretched
+/// partials of the stiff string, and a Thiran all pass tuning the loop to the
+/// fundamental. A point force F sends F / 2c into both lines, c being the
+/// wave speed, so bows, plucks, strikes and the audio input excite it the way
+/// they excite a finite difference string. Hammers and the finger need the
+/// grid of a finite difference string, and are ignored.
+///
+/// Excitations and pickups are placed on a virtual grid of `n` points, which
+/// only sets their resolution. The displacement at a pickup is integrated from
+/// its velocity, with a slight leak below 1 Hz, such that it cannot drift.
+class WaveguideString : public StringModel
+{
+    public:
+    /// Create a string at rest.
+    /// @param  n               The number of points of the virtual grid
+    ///                         excitations and pickups are placed on.
+    /// @param  sampleRate      The sample rate to use (default 44100).
+    /// @param  minFrequency    The lowest fundamental the string can be tuned
+    ///                         to, which sets the length of the delay lines.
+    WaveguideString(int n, float sampleRate = 44100, float minFrequency = 20);
+
+    /// Apply a force to the string.
+    /// @param  i       Where to apply the force, on the virtual grid.
+    /// @param  force   The magnitude of the force to apply.
+    void applyForce(int i, float force) override;
+
+    /// Compute the forces of all bows, plucks and strikes for the coming time
+    /// step.
+    void computeForces() override;
+
+    /// Draw a UI for controlling the string.
+    void draw(bool plot = true) override;
+
+    /// Excite the string by displacing a raised cosine, released at rest.
+    void excite() override;
+
+    /// Compute and get the next output sample.
+    /// @returns    The sum of all pickups.
+    float getNext() override;
+
+    /// Compute the next time step and read all pickups into one frame.
+    /// @param  frame           Where to write the frame.
+    /// @param  numChannels     The number of channels in the frame.
+    void getNext(float *frame, int numChannels) override;
+
+    /// Get the bows, plucks and strikes exciting the string.
+    Excitations &getExcitations() override { return excitations; };
+
+    /// Get how far a force applied at a point with `applyForce` moves the
+    /// point in the next time step.
+    /// @param  point   The point.
+    float getForceGain(const ExcitationPoint &point) const override;
+
+    /// Get the energy of the travelling waves, measured after the last block
+    /// computed by `process`.
+    float getEnergy() const override { return energy; };
+
+    /// Get the fundamental the loop is tuned to, which is lower than asked
+    /// for if the delay lines are too short.
+    float getFrequency() const { return frequency; };
+
+    /// Get the parameters of the string.
+    const StringParameters &getParameters() const override { return params; };
+
+    /// Get the pickups reading the string.
+    Pickups &getPickups() override { return pickups; };
+
+    /// Get the number of points of the virtual grid.
+    int getSize() const override { return n; };
+
+    /// Predict the value of the string at a point after the next time step.
+    /// The displacement is integrated along the delay lines, which makes this
+    /// far more costly than a time step.
+    /// @param  point   The point.
+    float predict(const ExcitationPoint &point) const override;
+
+    /// Compute a block of output.
+    /// @param  out             Where to write the interleaved output.
+    /// @param  numFrames       The number of frames to compute.
+    /// @param  numChannels     The number of channels per frame.
+    void process(float *out, int numFrames, int numChannels) override;
+
+    /// Reset the string state to zero.
+    void reset() override;
+
+    /// Set the force of the first bow.
+    /// @param  value   The desired bow force.
+    void setBowForce(float value) override;
+
+    /// Set all parameters of the string at once, redesigning the loop.
+    /// @param  value   The desired parameters.
+    void setParameters(const StringParameters &value) override;
+
+    /// Ignore the cache, as the loop filters are a handful of numbers.
+    void setTableCache(const std::shared_ptr<StringTableCache> &) override {};
+
+    /// Set the parameters the tables were made for, redesigning the loop.
+    /// @param  value   The tables.
+    void setTables(const std::shared_ptr<const StringTables> &value) override;
+
+    /// Set the wave speed corresponding to a frequency.
+    /// @param  freq    The desired frequency.
+    void setWavespeedFromFreq(float freq) override;
+
+    static constexpr int dispersionSections = 4;   // Second-order all pass
+                                                    // sections for stiffness.
+    static constexpr float silence = 1e-30;         // The energy below which
+                                                    // the string is at rest.
+
+    private:
+    /// Design the loop filters and the lengths of the delay lines from the
+    /// parameters.
+    void design();
+
+    /// Integrate the displacement at a position from the slope of the waves,
+    /// which is (v- - v+) / c, starting from the bridge.
+    /// @param  x   The position as a fraction of the string length.
+    float displacementAt(float x) const;
+
+    /// Add to the velocity of both waves at a position.
+    /// @param  x   The position as a fraction of the string length.
+    /// @param  dv  The velocity to add to each wave.
+    void inject(float x, float dv);
+
+    /// Move both waves one sample along and reflect them at the ends.
+    void propagate();
+
+    /// Apply the forces, read the pickups and advance one time step.
+    /// @param  frame           Where to write the frame.
+    /// @param  numChannels     The number of channels in the frame.
+    void step(float *frame, int numChannels);
+
+    /// Get the velocity of the string at a position.
+    /// @param  x   The position as a fraction of the string length.
+    float velocityAt(float x) const;
+
+    // The right-going waves start at the bridge (x = 0) and the left-going
+    // ones at the nut (x = 1). Tap t of each holds the wave t samples from
+    // where it starts.
+    pal::Delay right;
+    pal::Delay left;
+    int rightLength = 1;    // The taps on the string in each line.
+    int leftLength = 1;
+
+    pal::Filter loop;       // Loss and fractional delay.
+    pal::Filter dispersion[dispersionSections];
+    int numSections = 0;    // The dispersion sections in use.
+
+    StringParameters params;
+    Excitations excitations;
+    Pickups pickups;
+    SparseForces f;
+
+    int n = 0;              // Points of the virtual grid.
+    float k = 0;            // Sample period.
+    float h = 0;            // Spacing of the virtual grid.
+    float c = 1;            // Wave speed.
+    float leak = 1;         // Leak of the displacement integrators.
+    float frequency = 0;    // Tuned fundamental.
+    float energy = 0;       // Energy after the last block.
+};
@@ -0,0 +1,60 @@
+// Measures the strong scaling of the parallel solver: a single large string
+// is run for a fixed number of samples on 1 to 16 threads. Rows with more
+// threads than the machine has cores are marked, as they only measure the
+// cost of the threads sharing cores, not the scaling.
+//
+//     $ make bench && ./bench/ParallelScaling [points] [seconds]
+
+#include "../StiffString.h"
+#include <chrono>
+#include <cstdlib>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : 65536;
+    float seconds = argc > 2 ? atof(argv[2]) : 1;
+
+    // Lower the wave speed and stiffness, such that the grid is stable.
+    StringParameters params;
+    params.gamma0 = 0.01;
+    params.kappa0 = 1e-14;
+    params.sigma1 = 1e-9;
+
+    const int blockSize = 256;
+    int numFrames = seconds * 44100;
+    std::vector<float> out(blockSize);
+    double reference = 0;
+
+    int numCores = std::thread::hardware_concurrency();
+
+    printf("%i points, %.1f s of audio, %i cores\n", n, seconds, numCores);
+    printf("threads  time (s)  speedup  efficiency\n");
+
+    for (int numThreads = 1; numThreads <= 16; numThreads *= 2)
+    {
+        StiffString string(n);
+        string.setParameters(params);
+        string.setBowForce(0);
+        string.setTemporalBlocking(1);
+        string.setNumThreads(numThreads);
+        string.getExcitations().strike(0.3, 100);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (int frame = 0; frame < numFrames; frame += blockSize)
+            string.process(out.data(), blockSize, 1);
+
+        double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (numThreads == 1)
+            reference = time;
+
+        printf("%7i  %8.3f  %7.2f  %10.2f%s\n", numThreads, time, reference / time,
+            reference / time / numThreads, numThreads > numCores ? "  (oversubscribed)" : "");
+    }
+
+    return 0;
+}
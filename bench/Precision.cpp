@@ -0,0 +1,161 @@
+// Compares float, double and mixed precision for a dynamically sized string:
+// the cost of each, and how far the partials drift over time in a lossless
+// string, where any change in frequency or level is numerical error.
+//
+//     $ make bench && ./bench/Precision
+
+#include "../StiffString.h"
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+#include <vector>
+
+struct Partial
+{
+    float freq = 0;
+    float level = 0;
+};
+
+// Find the strongest partial near a frequency in one second of output, using
+// a Hann windowed DFT with parabolic interpolation of the peak.
+static Partial findPartial(const float *x, float freq)
+{
+    const int length = 44100;
+    float best[3] = {0, 0, 0};
+    int bestBin = 0;
+    auto magnitude = [&](int bin)
+    {
+        double re = 0;
+        double im = 0;
+
+        for (int i = 0; i < length; i++)
+        {
+            double w = 0.5 - 0.5 * cos(2 * M_PI * i / length);
+            re += w * x[i] * cos(2 * M_PI * bin * i / length);
+            im -= w * x[i] * sin(2 * M_PI * bin * i / length);
+        }
+
+        return (float)sqrt(re * re + im * im);
+    };
+
+    for (int bin = 0.9 * freq; bin <= 1.1 * freq; bin++)
+    {
+        float m = magnitude(bin);
+
+        if (m > best[1])
+        {
+            best[1] = m;
+            bestBin = bin;
+        }
+    }
+
+    best[0] = magnitude(bestBin - 1);
+    best[2] = magnitude(bestBin + 1);
+
+    float a = logf(best[0]);
+    float b = logf(best[1]);
+    float c = logf(best[2]);
+    float offset = 0.5f * (a - c) / (a - 2 * b + c);
+
+    Partial partial;
+    partial.freq = bestBin + offset;
+    partial.level = 20 * (b - 0.25f * (a - c) * offset) / logf(10);
+    return partial;
+}
+
+struct Result
+{
+    double time = 0;
+    Partial first[2];
+    Partial last[2];
+};
+
+static Result run(StringParameters params, Precision precision, float seconds, const float *freqs)
+{
+    params.sigma0 = 0;
+    params.sigma1 = 0;
+
+    StiffString string(computeStableSize(params));
+    string.setParameters(params);
+    string.setPrecision(precision);
+    string.setBowForce(0);
+    string.getExcitations().strike(0.23, 100);
+
+    std::vector<float> out(seconds * 44100);
+
+    auto start = std::chrono::steady_clock::now();
+    string.process(out.data(), out.size(), 1);
+
+    Result result;
+    result.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (int p = 0; p < 2; p++)
+    {
+        result.first[p] = findPartial(out.data(), freqs[p]);
+        result.last[p] = findPartial(out.data() + out.size() - 44100, freqs[p]);
+    }
+
+    return result;
+}
+
+int main()
+{
+    const float seconds = 30;
+    const char *names[] = {"float", "double", "mixed"};
+    Precision precisions[] = {Precision::Float, Precision::Double, Precision::Mixed};
+
+    struct Case
+    {
+        const char *name;
+        float gamma0;
+        float kappa0;
+    };
+
+    Case cases[] = {
+        {"110 Hz", 220 * 220, 10},
+        {"55 Hz, fine", 110 * 110, 0.1},
+        {"110 Hz, stiff", 220 * 220, 1000},
+    };
+
+    for (const Case &c : cases)
+    {
+        StringParameters params;
+        params.gamma0 = c.gamma0;
+        params.kappa0 = c.kappa0;
+
+        // The first and fifth partial, from the double precision string.
+        float nominal[2] = {sqrtf(c.gamma0) / 2, 5 * sqrtf(c.gamma0) / 2};
+        Result reference = run(params, Precision::Double, 2, nominal);
+        float freqs[2] = {reference.first[0].freq, reference.first[1].freq};
+
+        printf("%s, %i points, lossless, %.0f s\n", c.name, computeStableSize(params), seconds);
+        printf("precision  x realtime  partial  detune (cents)  level drift (dB)\n");
+
+        Result results[3];
+
+        for (int i = 0; i < 3; i++)
+            results[i] = run(params, precisions[i], seconds, freqs);
+
+        for (int i = 0; i < 3; i++)
+        {
+            for (int p = 0; p < 2; p++)
+            {
+                // Detuning is relative to the double precision string at the
+                // same time, level drift is the change over the run.
+                float detune = 1200 * log2f(results[i].last[p].freq / results[1].last[p].freq);
+                float drift = results[i].last[p].level - results[i].first[p].level;
+
+                if (p == 0)
+                    printf("%-9s  %10.0f", names[i], seconds / results[i].time);
+                else
+                    printf("%-9s  %10s", "", "");
+
+                printf("  %7i  %14.3f  %16.3f\n", p == 0 ? 1 : 5, detune, drift);
+            }
+        }
+
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Compares the accuracy and throughput of storing the state of a voice bank
+// in float, half and bfloat16, while always computing in float.
+//
+//     $ make bench && ./bench/ReducedPrecision
+
+#include "../StringFactory.h"
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+#include <vector>
+
+static const int size = 64;
+static const int blockSize = 256;
+
+static std::unique_ptr<StringModel> makeVoice(Precision precision, float freq)
+{
+    StringParameters params;
+    params.gamma0 = powf(2 * freq, 2);
+
+    auto voice = makeStiffString(size, params, BoundaryCondition::SimplySupported, precision);
+    voice->setBowForce(0);
+    voice->getExcitations().strike(0.23, 100);
+    return voice;
+}
+
+static std::vector<float> render(Precision precision, float seconds)
+{
+    auto voice = makeVoice(precision, 110);
+    std::vector<float> out(seconds * 44100);
+    voice->process(out.data(), out.size(), 1);
+    return out;
+}
+
+int main()
+{
+    const char *names[] = {"float", "double", "half", "bfloat16"};
+    Precision precisions[] = {Precision::Float, Precision::Half, Precision::BFloat16};
+
+    // Accuracy against a double precision reference, in dB relative to the
+    // peak of the reference. The late error shows how quantization behaves
+    // once the string has decayed.
+    const float seconds = 10;
+    auto reference = render(Precision::Double, seconds);
+    float peak = 0;
+
+    for (float y : reference)
+        peak = fmaxf(peak, fabsf(y));
+
+    printf("Accuracy over %.0f s, error relative to peak\n", seconds);
+    printf("storage   first second (dB)  last second (dB)  stable\n");
+
+    for (Precision precision : precisions)
+    {
+        auto out = render(precision, seconds);
+        float early = 0;
+        float late = 0;
+        bool stable = true;
+
+        for (int i = 0; i < out.size(); i++)
+        {
+            float error = fabsf(out[i] - reference[i]);
+            stable = stable && std::isfinite(out[i]) && fabsf(out[i]) <= 2 * peak;
+
+            if (i < 44100)
+                early = fmaxf(early, error);
+            else if (i >= out.size() - 44100)
+                late = fmaxf(late, error);
+        }
+
+        printf("%-8s  %18.1f  %16.1f  %s\n", names[(int)precision],
+            20 * log10f(early / peak + 1e-30f), 20 * log10f(late / peak + 1e-30f),
+            stable ? "yes" : "no");
+    }
+
+    // Throughput of banks of voices, each running in its own block.
+    printf("\nThroughput of %i point voices\n", size);
+    printf("storage   voices  state (KiB)  voices per core\n");
+
+    for (Precision precision : precisions)
+    {
+        for (int numVoices : {64, 256, 1024})
+        {
+            std::vector<std::unique_ptr<StringModel>> voices;
+
+            for (int i = 0; i < numVoices; i++)
+                voices.push_back(makeVoice(precision, 55 + i % 64));
+
+            std::vector<float> out(blockSize);
+            int numBlocks = 44100 / blockSize;
+
+            auto start = std::chrono::steady_clock::now();
+
+            for (int block = 0; block < numBlocks; block++)
+            {
+                for (auto &voice : voices)
+                    voice->process(out.data(), blockSize, 1);
+            }
+
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double audio = (double)numBlocks * blockSize / 44100;
+            // Three float states, or a 16-bit state and increment.
+            int bytes = precision == Precision::Float ? 3 * 4 : 2 * 2;
+
+            printf("%-8s  %6i  %11.0f  %15.0f\n", names[(int)precision], numVoices,
+                (double)size * bytes * numVoices / 1024, numVoices * audio / time);
+        }
+    }
+
+    return 0;
+}
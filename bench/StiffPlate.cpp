@@ -0,0 +1,77 @@
+// Measures the cost of a stiff plate per point and time step at typical plate
+// sizes, for several tile widths and numbers of threads, and how many
+// plates of each size run in real time on one core.
+//
+//     $ make bench && ./bench/StiffPlate [seconds] [max threads]
+
+#include "../StiffPlate.h"
+#include <chrono>
+#include <cstdlib>
+#include <stdio.h>
+#include <vector>
+
+static const int blockSize = 256;
+static const float sampleRate = 44100;
+
+static double run(int nx, int ny, int tileWidth, int numThreads, float seconds)
+{
+    // A stiff plate with little tension, stable at the largest size.
+    StringParameters params;
+    params.gamma0 = 100;
+    params.kappa0 = 1e-3;
+    params.sigma0 = 1;
+    params.sigma1 = 1e-6;
+
+    StiffPlate plate(nx, ny, sampleRate);
+    plate.setParameters(params);
+    plate.setTileWidth(tileWidth);
+    plate.setNumThreads(numThreads);
+    plate.addPickup(0.3, 0.7, 1, -0.5);
+    plate.addPickup(0.8, 0.2, 1, 0.5);
+    plate.strike(0.4, 0.45, 10);
+
+    std::vector<float> out(2 * blockSize);
+    int numBlocks = seconds * sampleRate / blockSize;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int block = 0; block < numBlocks; block++)
+        plate.process(out.data(), blockSize, 2);
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+        / ((double)numBlocks * blockSize);
+}
+
+int main(int argc, char **argv)
+{
+    float seconds = argc > 1 ? atof(argv[1]) : 0.5;
+    int maxThreads = argc > 2 ? atoi(argv[2]) : 4;
+
+    // A small gong, a cymbal, a soundboard and a large tam-tam.
+    int sizes[][2] = {{64, 64}, {128, 128}, {256, 160}, {512, 512}};
+
+    printf("size       tile  threads  ns/point  plates in real time\n");
+
+    for (auto size : sizes)
+    {
+        int nx = size[0];
+        int ny = size[1];
+
+        // Tiles at least as wide as the plate leave the rows whole, so only
+        // the narrowest of those is measured.
+        for (int tileWidth : {64, 256, 1024})
+        {
+            if (tileWidth > 64 && tileWidth / 4 >= nx)
+                continue;
+
+            for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+            {
+                double step = run(nx, ny, tileWidth, numThreads, seconds);
+
+                printf("%4ix%-4i  %5i  %7i  %8.2f  %19.1f\n", nx, ny, tileWidth, numThreads,
+                    1e9 * step / (nx * ny), 1 / (step * sampleRate));
+            }
+        }
+    }
+
+    return 0;
+}
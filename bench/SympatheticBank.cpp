@@ -0,0 +1,98 @@
+// Measures the cost of a bank of sympathetic strings against finite
+// difference strings of the same pitches, and how many strings the idle skip
+// puts to sleep once the drive stops.
+//
+//     $ make bench && ./bench/SympatheticBank
+
+#include "../StringFactory.h"
+#include "../SympatheticBank.h"
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+#include <vector>
+
+static const int blockSize = 256;
+static const float sampleRate = 44100;
+
+static float pitch(int i)
+{
+    return 110 * powf(2, i / 12.0f);
+}
+
+int main()
+{
+    StringParameters params;
+    params.kappa0 = 1;
+    params.sigma0 = 1;
+
+    printf("strings  bank (strings per core)  finite difference (strings per core)\n");
+
+    for (int numStrings : {12, 24, 48, 96})
+    {
+        SympatheticBank bank(sampleRate);
+        std::vector<std::unique_ptr<StringModel>> strings;
+
+        for (int i = 0; i < numStrings; i++)
+        {
+            bank.addString(pitch(i % 48), params);
+
+            StringParameters p = params;
+            p.gamma0 = powf(2 * pitch(i % 48), 2);
+            strings.push_back(makeStiffString(computeStableSize(p, sampleRate), p));
+            strings.back()->setBowForce(0);
+        }
+
+        // Drive the bank continuously, such that no string is skipped.
+        std::vector<float> drive(blockSize);
+        std::vector<float> out(2 * blockSize);
+        int numBlocks = sampleRate / blockSize;
+
+        for (int t = 0; t < blockSize; t++)
+            drive[t] = sinf(2 * M_PI * 220 * t / sampleRate);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (int block = 0; block < numBlocks; block++)
+            bank.process(drive.data(), out.data(), blockSize, 2);
+
+        double bankTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+
+        for (int block = 0; block < numBlocks; block++)
+        {
+            for (auto &string : strings)
+                string->process(out.data(), blockSize, 1);
+        }
+
+        double stringTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double audio = (double)numBlocks * blockSize / sampleRate;
+
+        printf("%7i  %23.0f  %36.0f\n", numStrings, numStrings * audio / bankTime, numStrings * audio / stringTime);
+    }
+
+    // Drive 48 strings with a short burst and count the strings left awake.
+    SympatheticBank bank(sampleRate);
+
+    for (int i = 0; i < 48; i++)
+        bank.addString(pitch(i), params);
+
+    std::vector<float> drive(blockSize);
+    std::vector<float> out(2 * blockSize);
+    int frame = 0;
+
+    printf("\ntime (s)  awake\n");
+
+    for (int block = 0; block < 10 * sampleRate / blockSize; block++)
+    {
+        for (int t = 0; t < blockSize; t++, frame++)
+            drive[t] = frame < sampleRate / 2 ? 1000 * sinf(2 * M_PI * 220 * frame / sampleRate) : 0;
+
+        bank.process(drive.data(), out.data(), blockSize, 2);
+
+        if (block % 172 == 0)
+            printf("%8.1f  %5i\n", frame / sampleRate, bank.getNumAwake());
+    }
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Compares the cost per point and time step of a uniform string, one with a
+// profile that is the same all along, which should cost the same, and a
+// wound string, whose coefficients are streamed alongside the state.
+//
+//     $ make bench && ./bench/VaryingString [seconds]
+
+#include "../StiffString.h"
+#include <chrono>
+#include <cstdlib>
+#include <stdio.h>
+#include <vector>
+
+static const int blockSize = 256;
+
+static double run(int n, const StringProfile &profile, Precision precision, float seconds)
+{
+    StiffString string(n);
+    string.setBowForce(0);
+    string.setTemporalBlocking(1);
+    string.setPrecision(precision);
+    string.setProfile(profile);
+    string.getExcitations().strike(0.23, 100);
+
+    std::vector<float> out(blockSize);
+    int numBlocks = seconds * 44100 / blockSize;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int block = 0; block < numBlocks; block++)
+        string.process(out.data(), blockSize, 1);
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+        / ((double)numBlocks * blockSize * n);
+}
+
+int main(int argc, char **argv)
+{
+    float seconds = argc > 1 ? atof(argv[1]) : 1;
+    const char *names[] = {"float", "double", "mixed"};
+    Precision precisions[] = {Precision::Float, Precision::Double, Precision::Mixed};
+
+    // A string wound over its lower half, with the winding adding mass but
+    // little stiffness.
+    StringProfile uniform;
+    StringProfile flat;
+    flat.mass = {2, 2};
+    StringProfile wound;
+    wound.mass = {1, 1, 3, 3};
+    wound.stiffness = {1, 1, 1.2, 1.2};
+
+    printf("points  precision  uniform (ns)  flat profile (ns)  wound (ns)\n");
+
+    for (int n : {64, 256, 1024, 4096})
+    {
+        for (int p = 0; p < 3; p++)
+        {
+            printf("%6i  %-9s  %12.2f  %17.2f  %10.2f\n", n, names[p],
+                1e9 * run(n, uniform, precisions[p], seconds),
+                1e9 * run(n, flat, precisions[p], seconds),
+                1e9 * run(n, wound, precisions[p], seconds));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+// Compares the cost per voice of a waveguide string with that of a finite
+// difference string on the stable grid for the same note, as played by the
+// voice allocator: plucked again every half second and read by one pickup.
+// The waveguide costs the same at any pitch and stiffness, while the grid of
+// a flexible string grows with the number of partials below Nyquist.
+//
+//     $ make bench && ./bench/Waveguide [seconds]
+
+#include "../StringFactory.h"
+#include "../WaveguideString.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <stdio.h>
+#include <vector>
+
+static const int blockSize = 256;
+static const float sampleRate = 44100;
+
+static double run(StringModel &string, float seconds)
+{
+    string.setBowForce(0);
+
+    std::vector<float> out(2 * blockSize);
+    int numBlocks = seconds * sampleRate / blockSize;
+    int pluckBlocks = 0.5 * sampleRate / blockSize;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int block = 0; block < numBlocks; block++)
+    {
+        if (block % pluckBlocks == 0)
+            string.getExcitations().pluck(0.2, 10, 0.005, 0.02);
+
+        string.process(out.data(), blockSize, 2);
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+        / ((double)numBlocks * blockSize);
+}
+
+int main(int argc, char **argv)
+{
+    float seconds = argc > 1 ? atof(argv[1]) : 2;
+
+    printf("kappa0  note (Hz)  points  difference (ns)  waveguide (ns)  ratio  waveguides in real time\n");
+
+    // A stiff string and a nearly flexible one.
+    for (float kappa : {10.0f, 0.1f})
+    {
+        for (float freq : {55.0f, 110.0f, 220.0f, 440.0f, 880.0f, 1760.0f})
+        {
+            StringParameters params;
+            params.gamma0 = powf(2 * freq, 2);
+            params.kappa0 = kappa;
+            int n = computeStableSize(params, sampleRate);
+
+            auto string = makeStiffString(n, params, BoundaryCondition::SimplySupported, Precision::Float, sampleRate);
+            WaveguideString waveguide(n, sampleRate);
+            waveguide.setParameters(params);
+
+            double difference = run(*string, seconds);
+            double cheap = run(waveguide, seconds);
+
+            printf("%6g  %9.0f  %6i  %15.1f  %14.1f  %5.1f  %23.0f\n", kappa, freq, n, 1e9 * difference,
+                1e9 * cheap, difference / cheap, 1 / (cheap * sampleRate));
+        }
+    }
+
+    return 0;
+}
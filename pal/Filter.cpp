@@ -59,6 +59,8 @@ void Filter::makeBandPass(float f0, float q)
     a0 = 1 + alpha;
     a1 = - 2 * cos(omega0);
     a2 = 1 - alpha;
+
+    normalize();
 }
 
 void Filter::makeHighPass(float f0, float q)
@@ -77,6 +79,8 @@ void Filter::makeHighPass(float f0, float q)
     a0 = 1 + alpha;
     a1 = - 2 * cos(omega0);
     a2 = 1 - alpha;
+
+    normalize();
 }
 
 void Filter::makeLowPass(float f0, float q)
@@ -95,20 +99,18 @@ void Filter::makeLowPass(float f0, float q)
     a0 = 1 + alpha;
     a1 = - 2 * cos(omega0);
     a2 = 1 - alpha;
+
+    normalize();
 }
 
-float Filter::process(float x)
+void Filter::normalize()
 {
-    float y = (b0 / a0) * x + (b1 / a0) * x1 + (b2 / a0) * x2
-                            - (a1 / a0) * y1 - (a2 / a0) * y2;
-
-    y2 = y1;
-    y1 = y;
-
-    x2 = x1;
-    x1 = x;
-
-    return y;
+    b0 /= a0;
+    b1 /= a0;
+    b2 /= a0;
+    a1 /= a0;
+    a2 /= a0;
+    a0 = 1;
 }
 
 void Filter::reset()
@@ -119,4 +121,14 @@ void Filter::reset()
     x2 = 0;
 }
 
-}
\ No newline at end of file
+void Filter::setCoefficients(float b0, float b1, float b2, float a1, float a2)
+{
+    this->b0 = b0;
+    this->b1 = b1;
+    this->b2 = b2;
+    this->a0 = 1;
+    this->a1 = a1;
+    this->a2 = a2;
+}
+
+}
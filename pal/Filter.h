@@ -17,6 +17,16 @@ class Filter
     ///
     void draw();
 
+    /// Set the filter coefficients directly, such as for an all pass filter
+    /// designed elsewhere. The coefficients are normalized such that a0 is 1.
+    ///
+    /// @param  b0      The weight of the input.
+    /// @param  b1      The weight of the previous input.
+    /// @param  b2      The weight of the input before that.
+    /// @param  a1      The weight of the previous output.
+    /// @param  a2      The weight of the output before that.
+    void setCoefficients(float b0, float b1, float b2, float a1, float a2);
+
     /// Set the filter coefficients to make a band pass filter.
     ///
     /// @param  f0      The desired cutoff frequency.
@@ -52,6 +62,9 @@ class Filter
     void setSampleRate(float value) { sampleRate = value; };
 
     private:
+    /// Divide all coefficients by a0, such that processing a sample takes no
+    /// divisions.
+    void normalize();
 
     enum FilterType
     {
@@ -80,4 +93,20 @@ class Filter
     float uiF0 = 1000;
     float uiQ = 2;
 };
-}
\ No newline at end of file
+
+inline float Filter::process(float x)
+{
+    // Sum the terms of past samples first, such that the input only waits on
+    // a single multiply-add when filters are chained.
+    float y = b0 * x + (b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2);
+
+    y2 = y1;
+    y1 = y;
+
+    x2 = x1;
+    x1 = x;
+
+    return y;
+}
+
+}
@@ -39,7 +39,7 @@ void RealTimeAudio::draw()
 {
     int numDevices = Pa_GetDeviceCount();
 
-    if (ImGui::BeginCombo("Input device", Pa_GetDeviceInfo(selectedInputDevice)->name, 0))
+    if (numInputChannels > 0 && ImGui::BeginCombo("Input device", Pa_GetDeviceInfo(selectedInputDevice)->name, 0))
     {
         for (int i = 0; i < numDevices; i++)
         {
@@ -113,6 +113,23 @@ void RealTimeAudio::draw()
     }
 }
 
+void RealTimeAudio::setNumInputChannels(int value)
+{
+    if (value == numInputChannels)
+    {
+        return;
+    }
+
+    bool wasRunning = audioIsRunning;
+    stop();
+    numInputChannels = value;
+
+    if (wasRunning)
+    {
+        start();
+    }
+}
+
 void RealTimeAudio::start()
 {
     if (audioIsRunning)
@@ -123,7 +140,7 @@ void RealTimeAudio::start()
     PaStreamParameters inputParameters;
     PaStreamParameters outputParameters;
     inputParameters.device = selectedInputDevice;
-    inputParameters.channelCount = 2;
+    inputParameters.channelCount = numInputChannels;
     inputParameters.sampleFormat = paFloat32;
     inputParameters.suggestedLatency = 0.005;
     inputParameters.hostApiSpecificStreamInfo = NULL;
@@ -141,12 +158,14 @@ void RealTimeAudio::start()
     outputParameters.hostApiSpecificStreamInfo = &macCoreStreamInfo;
 #endif
 
+    // Only open the input when it is used, which saves its latency and the
+    // work of the driver.
     auto err = Pa_OpenStream(
         &this->stream,
-        &inputParameters,
+        numInputChannels > 0 ? &inputParameters : NULL,
         &outputParameters,
         44100,
-        512,
+        framesPerBuffer,
         paClipOff,
         paCallback,
         this);
@@ -172,5 +191,6 @@ void RealTimeAudio::stop()
     {
         audioIsRunning = false;
         Pa_StopStream(stream);
+        Pa_CloseStream(stream);
     }
 }
\ No newline at end of file
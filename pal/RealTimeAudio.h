@@ -17,12 +17,27 @@ class RealTimeAudio
     void start();
     void stop();
 
-    /// The callback function used to render audio.
+    /// Get the number of frames passed to the callback at a time, which is
+    /// the same for every call, such that buffers can be sized up front.
+    int getFramesPerBuffer() const { return framesPerBuffer; };
+
+    /// Get the number of input channels opened.
+    int getNumInputChannels() const { return numInputChannels; };
+
+    /// Set the number of input channels to open, restarting audio if it is
+    /// running. With no input channels, which is the default, no input
+    /// stream is opened and the callback gets no input.
+    void setNumInputChannels(int value);
+
+    /// The callback function used to render audio. The input is interleaved
+    /// with `getNumInputChannels()` channels per frame, or null.
     std::function<void(int, int, float *, float *)> callback;
 
     private:
     int selectedInputDevice;
     int selectedOutputDevice;
+    int numInputChannels = 0;
+    int framesPerBuffer = 512;
     bool audioIsRunning = false;
     PaStream *stream;
 };
\ No newline at end of file
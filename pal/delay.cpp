@@ -12,61 +12,6 @@ namespace pal
         index = 0;
     }
 
-    void Delay::proceed()
-    {
-        index = (index + 1) % buffer.size();
-    }
-
-    float Delay::read()
-    {
-        int i = index - getLength();
-
-        // This is an efficient way of wrapping `i` around in case it is less
-        // than zero.
-        i = i + (i < 0) * getLength();
-
-        return buffer[i];
-    }
-
-    float Delay::readAt(int n)
-    {
-        int i = index - n;
-
-        // This is an efficient way of wrapping `i` around in case it is less
-        // than zero.
-        i = i + (i < 0) * getLength();
-
-        return buffer[i];
-    }
-
-    float Delay::readFractional(float n)
-    {
-        int upper = ceil(n);
-        int lower = floor(n);
-        float a = n - lower;
-
-        float x1 = readAt(lower);
-        float x2 = readAt(upper);
-        float y = x1 + a * (x2 - x1);
-        return y;
-    }
-
-    void Delay::write(float x)
-    {
-        buffer[index] = x;
-    }
-
-    void Delay::writeAt(float x, int n)
-    {
-        int i = index - n;
-
-        // This is an efficient way of wrapping `i` around in case it is less
-        // than zero.
-        i = i + (i < 0) * getLength();
-
-        buffer[i] = x;
-    }
-
 #ifdef PAL_TEST
     void Delay::test()
     {
@@ -13,7 +13,7 @@ namespace pal
         Delay(int length);
 
         /// Get the number of samples in the delay line.
-        int getLength() { return buffer.size() - 1; };
+        int getLength() const { return buffer.size() - 1; };
 
         /// Proceed the internal read and write pointers. Should be called after
         /// a sample has been processed.
@@ -21,13 +21,13 @@ namespace pal
 
         /// Read the sample at the end of the delay line.
         /// @returns    The oldest value in the delay line.
-        float read();
+        float read() const;
 
         /// Read a sample at a specified position.
         /// @param  n   The position to read at, zero being the most recent
         ///             sample, limited to the length of the delay line.
         /// @returns    The sample at position `n`.
-        float readAt(int n);
+        float readAt(int n) const;
 
         /// Read a sample at a decimal position using linear interpolation.
         /// @param n    The position to read at, zero being the most recent
@@ -35,7 +35,7 @@ namespace pal
         ///             a decimal number.
         /// @returns    The sample at position `n`, computed using linear
         ///             interpolation if `n` is fractional.
-        float readFractional(float n);
+        float readFractional(float n) const;
 
         /// Write a sample to the delay line.
         /// @param  x   The sample value to write into the delay line.
@@ -55,4 +55,51 @@ namespace pal
         int index = 0;
         std::vector<float> buffer;
     };
-}
\ No newline at end of file
+
+    inline void Delay::proceed()
+    {
+        index = index + 1 < buffer.size() ? index + 1 : 0;
+    }
+
+    inline float Delay::read() const
+    {
+        return readAt(getLength());
+    }
+
+    inline float Delay::readAt(int n) const
+    {
+        int i = index - n;
+
+        // This is an efficient way of wrapping `i` around in case it is less
+        // than zero.
+        i = i + (i < 0) * (int)buffer.size();
+
+        return buffer[i];
+    }
+
+    inline float Delay::readFractional(float n) const
+    {
+        int lower = n;
+        float a = n - lower;
+
+        float x1 = readAt(lower);
+        float x2 = a > 0 ? readAt(lower + 1) : x1;
+        return x1 + a * (x2 - x1);
+    }
+
+    inline void Delay::write(float x)
+    {
+        buffer[index] = x;
+    }
+
+    inline void Delay::writeAt(float x, int n)
+    {
+        int i = index - n;
+
+        // This is an efficient way of wrapping `i` around in case it is less
+        // than zero.
+        i = i + (i < 0) * (int)buffer.size();
+
+        buffer[i] = x;
+    }
+}